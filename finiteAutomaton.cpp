@@ -1,3 +1,4 @@
+#pragma once
 #include <string> 
 #include <iostream>
 #include <map> 
@@ -6,6 +7,11 @@
 #include <cassert> 
 #include <queue> 
 #include <algorithm> 
+#include <utility> 
+#include <memory> 
+#include <memory_resource> 
+#include <atomic> 
+#include <chrono> 
 
 template<typename Tletter>
 std::vector<Tletter> defaultAlphabetLetters() {
@@ -26,15 +32,76 @@ char defaultZeroLetter() {
   return '.';
 }
 
-template<typename Tvertex, typename Tletter>
+// May be cancelled from any thread while an algorithm runs in another one.
+class finiteAutomaton_cancellationToken {
+private:
+  std::atomic<bool> isCancelled_{false};
+
+public:
+  void cancel() {
+    isCancelled_.store(true, std::memory_order_relaxed);
+  }
+
+  bool isCancelled() const {
+    return isCancelled_.load(std::memory_order_relaxed);
+  }
+};
+
+// Checked by determine, minimize and getExpression between steps: the token, the deadline and the progress callback,
+// which gets (vertices done, vertices left). After a stop the algorithm returns at once with an empty automaton
+// (an empty string for getExpression) and isStopped() is true, such a result must not be used.
+class finiteAutomaton_runControl {
+public:
+  using Tclock = std::chrono::steady_clock;
+  using TprogressCallback = std::function<void(size_t, size_t)>;
+
+private:
+  const finiteAutomaton_cancellationToken* token_;
+  Tclock::time_point deadline_;
+  TprogressCallback onProgress_;
+  bool isStopped_;
+
+public:
+  explicit finiteAutomaton_runControl(const finiteAutomaton_cancellationToken* token = nullptr,
+                                      Tclock::time_point deadline = Tclock::time_point::max(),
+                                      TprogressCallback onProgress = TprogressCallback()):
+    token_(token),
+    deadline_(deadline),
+    onProgress_(std::move(onProgress)),
+    isStopped_(false) {}
+
+  bool shouldStop(size_t doneCount, size_t leftCount) {
+    if (onProgress_) {
+      onProgress_(doneCount, leftCount);
+    }
+    if ((token_ != nullptr && token_->isCancelled()) || (deadline_ != Tclock::time_point::max() && Tclock::now() >= deadline_)) {
+      isStopped_ = true;
+    }
+    return isStopped_;
+  }
+
+  bool isStopped() const {
+    return isStopped_;
+  }
+};
+
+template<typename Tvertex, typename Tletter, typename Tallocator = std::allocator<Tvertex>>
 class finiteAutomaton_determinator;
 
-template<typename Tvertex, typename Tletter>
+template<typename Tvertex, typename Tletter, typename Tallocator = std::allocator<Tvertex>>
 class finiteAutomaton_minimizer;
 
-template<typename Tvertex, typename Tletter>
+template<typename Tvertex, typename Tletter, typename Tallocator = std::allocator<Tvertex>>
+class finiteAutomaton_reducer;
+
+// Tallocator serves the vertices and edges of the automaton, and the algorithms that build a new automaton
+// from it (determine, minimize, reduce, eraseZeroEdges) take their answer and scratch memory from the same allocator.
+template<typename Tvertex, typename Tletter, typename Tallocator = std::allocator<Tvertex>>
 class finiteAutomaton {
 public:
+  template<typename Tvalue>
+  using Trebind = typename std::allocator_traits<Tallocator>::template rebind_alloc<Tvalue>;
+
   class Edge {
   public:
     Tvertex start;
@@ -51,27 +118,34 @@ public:
     }
   };
 
-  std::vector<std::vector<Edge>> adjencyList_;
-  std::vector<bool> isTerminal_;
+  using TedgeList = std::vector<Edge, Trebind<Edge>>;
+  using TadjencyList = std::vector<TedgeList, Trebind<TedgeList>>;
+  using TterminalFlags = std::vector<bool, Trebind<bool>>;
+  using TresourceAllocator = std::pmr::polymorphic_allocator<Tvertex>;
+
+  TadjencyList adjencyList_;
+  TterminalFlags isTerminal_;
   Tvertex source_;
   
-  explicit finiteAutomaton(std::vector<std::vector<Edge>> sameAdjencyList, Tvertex sameSource, std::vector<bool> sameIsTerminal):
-    adjencyList_(sameAdjencyList),
-    isTerminal_(sameIsTerminal),
+  explicit finiteAutomaton(TadjencyList sameAdjencyList, Tvertex sameSource, TterminalFlags sameIsTerminal):
+    adjencyList_(std::move(sameAdjencyList)),
+    isTerminal_(std::move(sameIsTerminal)),
     source_(sameSource) {
-      assert(sameIsTerminal.size() == sameAdjencyList.size());
+      assert(isTerminal_.size() == adjencyList_.size());
     }
 
-  explicit finiteAutomaton(size_t vertexCount, Tvertex sameSource, std::vector<bool> sameIsTerminal):
-    adjencyList_(vertexCount),
-    isTerminal_(sameIsTerminal),
+  // The automaton takes the allocator of sameIsTerminal.
+  explicit finiteAutomaton(size_t vertexCount, Tvertex sameSource, TterminalFlags sameIsTerminal):
+    adjencyList_(vertexCount, TedgeList(sameIsTerminal.get_allocator()), sameIsTerminal.get_allocator()),
+    isTerminal_(std::move(sameIsTerminal)),
     source_(sameSource) {
-      assert(sameIsTerminal.size() == vertexCount);
+      assert(isTerminal_.size() == vertexCount);
     }
 
-  explicit finiteAutomaton(size_t vertexCount, Tvertex sameSource, std::vector<Tvertex> listOfTerminals):
-    adjencyList_(vertexCount),
-    isTerminal_(vertexCount, false),
+  explicit finiteAutomaton(size_t vertexCount, Tvertex sameSource, std::vector<Tvertex> listOfTerminals,
+                           const Tallocator& allocator = Tallocator()):
+    adjencyList_(vertexCount, TedgeList(allocator), allocator),
+    isTerminal_(vertexCount, false, allocator),
     source_(sameSource) {
       for (auto vertex: listOfTerminals) {
         isTerminal_[vertex] = true;
@@ -82,18 +156,36 @@ public:
     return adjencyList_.size();
   }
 
+  Tallocator getAllocator() const {
+    return Tallocator(isTerminal_.get_allocator());
+  }
+
+  // The same automaton in memory of another allocator, e.g. to take a result out of an arena.
+  template<typename TanotherAllocator>
+  finiteAutomaton<Tvertex, Tletter, TanotherAllocator> copyWithAllocator(const TanotherAllocator& allocator) const {
+    using TanotherAutomaton = finiteAutomaton<Tvertex, Tletter, TanotherAllocator>;
+    TanotherAutomaton answer(vertexCount(), source_, typename TanotherAutomaton::TterminalFlags(isTerminal_.begin(), isTerminal_.end(), allocator));
+    for (size_t vertex = 0; vertex < vertexCount(); ++vertex) {
+      answer.adjencyList_[vertex].reserve(adjencyList_[vertex].size());
+      for (const auto& edge: adjencyList_[vertex]) {
+        answer.insertEdge(edge.start, edge.finish, edge.letter);
+      }
+    }
+    return answer;
+  }
+
   Tvertex getSource() const {
     return source_;
   }
 
   class OutgoingEdgesIterator {
   private:
-    finiteAutomaton& network_;
+    const finiteAutomaton& network_;
     size_t index_;
     Tvertex vertex_;
   
   public:
-    explicit OutgoingEdgesIterator(finiteAutomaton& networkReference, size_t position, Tvertex vertex):
+    explicit OutgoingEdgesIterator(const finiteAutomaton& networkReference, size_t position, Tvertex vertex):
       network_(networkReference),
       index_(position),
       vertex_(vertex) {}
@@ -127,7 +219,7 @@ public:
     }
   };
 
-  OutgoingEdgesIterator getBegin(Tvertex vertex) {
+  OutgoingEdgesIterator getBegin(Tvertex vertex) const {
     return OutgoingEdgesIterator(*this, 0, vertex);
   }
 
@@ -137,43 +229,90 @@ public:
 
 private:
   void addVertex() {
-    adjencyList_.push_back({});
+    adjencyList_.emplace_back();
     isTerminal_.push_back(false);
   }
 
-  void dfsZeroLetter(Tvertex vertex, Tvertex startVertex, std::vector<bool>& isVertexUsed, 
-                     Tletter& zeroLetter, finiteAutomaton<Tvertex, Tletter>& answer) {
+  void dfsZeroLetter(Tvertex vertex, Tvertex startVertex, TterminalFlags& isVertexUsed, std::vector<Tvertex, Trebind<Tvertex>>& usedVertices,
+                     Tletter& zeroLetter, TterminalFlags& answerIsTerminal, TedgeList& answerEdges) const {
     isVertexUsed[vertex] = true;
+    usedVertices.push_back(vertex);
     if (isTerminal_[vertex]) {
-      answer.isTerminal_[startVertex] = true;
+      answerIsTerminal[startVertex] = true;
     } 
     for (auto adjacentEdgesIterator = getBegin(vertex); adjacentEdgesIterator.valid(); adjacentEdgesIterator.next()) {
       Tvertex adjacentVertex = adjacentEdgesIterator.getFinish();
       Tletter letter = adjacentEdgesIterator.getLetter();
       if (!isVertexUsed[adjacentVertex] && (letter == zeroLetter)) {
-        dfsZeroLetter(adjacentVertex, startVertex, isVertexUsed, zeroLetter, answer);
+        dfsZeroLetter(adjacentVertex, startVertex, isVertexUsed, usedVertices, zeroLetter, answerIsTerminal, answerEdges);
       }
       if (letter != zeroLetter) {
-        answer.insertEdge(startVertex, adjacentVertex, letter);
+        answerEdges.push_back(Edge(startVertex, adjacentVertex, letter));
       }
     }
   };
 
-public:  
-  finiteAutomaton<Tvertex, Tletter> eraseZeroEdges(Tletter zeroLetter) {
-    finiteAutomaton<Tvertex, Tletter> answer(vertexCount(), source_, isTerminal_);
+  // Closures are written straight into answerIsTerminal, which may be isTerminal_ itself:
+  // a vertex only becomes terminal when its eps-closure already reaches a terminal.
+  TadjencyList getZeroClosureEdges(Tletter zeroLetter, TterminalFlags& answerIsTerminal) const {
+    TadjencyList answerAdjencyList(vertexCount(), TedgeList(getAllocator()), getAllocator());
+    TterminalFlags isVertexUsed(vertexCount(), false, getAllocator());
+    std::vector<Tvertex, Trebind<Tvertex>> usedVertices(getAllocator());
     for (Tvertex vertex = 0; static_cast<size_t>(vertex) < vertexCount(); ++vertex) {
-      std::vector<bool> isVertexUsed(vertexCount(), false);
-      dfsZeroLetter(vertex, vertex, isVertexUsed, zeroLetter, answer);
+      dfsZeroLetter(vertex, vertex, isVertexUsed, usedVertices, zeroLetter, answerIsTerminal, answerAdjencyList[vertex]);
+      for (auto usedVertex: usedVertices) {
+        isVertexUsed[usedVertex] = false;
+      }
+      usedVertices.clear();
     }
-    return answer;
+    return answerAdjencyList;
+  }
+
+public:  
+  finiteAutomaton<Tvertex, Tletter, Tallocator> eraseZeroEdges(Tletter zeroLetter) const& {
+    TterminalFlags answerIsTerminal(isTerminal_, getAllocator());
+    auto answerAdjencyList = getZeroClosureEdges(zeroLetter, answerIsTerminal);
+    return finiteAutomaton<Tvertex, Tletter, Tallocator>(std::move(answerAdjencyList), source_, std::move(answerIsTerminal));
+  }
+
+  finiteAutomaton<Tvertex, Tletter, Tallocator> eraseZeroEdges(Tletter zeroLetter) && {
+    adjencyList_ = getZeroClosureEdges(zeroLetter, isTerminal_);
+    return std::move(*this);
+  }
+
+  finiteAutomaton<Tvertex, Tletter, Tallocator> determine() const& { 
+    finiteAutomaton_determinator<Tvertex, Tletter, Tallocator> algorithmInstance(*this);
+    return algorithmInstance.execute();
+  }
+
+  // The input is released as soon as the algorithm returns, not at the end of the full-expression.
+  finiteAutomaton<Tvertex, Tletter, Tallocator> determine() && { 
+    finiteAutomaton<Tvertex, Tletter, Tallocator> input(std::move(*this));
+    return input.determine();
   }
 
-  finiteAutomaton<Tvertex, Tletter> determine() { 
-    finiteAutomaton_determinator<Tvertex, Tletter> algorithmInstance(*this);
+  // The input is copied into resource and the algorithm works there, only the answer is copied back
+  // into the allocator of this automaton.
+  finiteAutomaton<Tvertex, Tletter, Tallocator> determine(std::pmr::memory_resource* resource) const& { 
+    return copyWithAllocator(TresourceAllocator(resource)).determine().copyWithAllocator(getAllocator());
+  }
+
+  finiteAutomaton<Tvertex, Tletter, Tallocator> determine(std::pmr::memory_resource* resource) && { 
+    finiteAutomaton<Tvertex, Tletter, Tallocator> input(std::move(*this));
+    return input.determine(resource);
+  }
+
+  // Stops when control says so, see finiteAutomaton_runControl.
+  finiteAutomaton<Tvertex, Tletter, Tallocator> determine(finiteAutomaton_runControl& control) const& { 
+    finiteAutomaton_determinator<Tvertex, Tletter, Tallocator> algorithmInstance(*this, &control);
     return algorithmInstance.execute();
   }
 
+  finiteAutomaton<Tvertex, Tletter, Tallocator> determine(finiteAutomaton_runControl& control) && { 
+    finiteAutomaton<Tvertex, Tletter, Tallocator> input(std::move(*this));
+    return input.determine(control);
+  }
+
   void printAllTerminals() const {
     for (Tvertex vertex = 0; static_cast<size_t>(vertex) < vertexCount(); ++vertex) {
       if (isTerminal_[vertex]) {
@@ -183,7 +322,7 @@ public:
     std::cout << "\n";
   }
 
-  void print() {
+  void print() const {
     for (Tvertex vertex = 0; static_cast<size_t>(vertex) < vertexCount(); ++vertex) {
       std::cout << vertex << ": ";
       for (auto adjacentEdgesIterator = getBegin(vertex); adjacentEdgesIterator.valid(); adjacentEdgesIterator.next()) {
@@ -195,7 +334,7 @@ public:
     printAllTerminals();
   }
 
-  std::vector<Edge> getEdges() {
+  std::vector<Edge> getEdges() const {
     std::vector<Edge> listOfEdges;
     for (size_t vertex = 0; vertex < vertexCount(); ++vertex) {
       for (auto adjacentEdgesIterator = getBegin(vertex); adjacentEdgesIterator.valid(); adjacentEdgesIterator.next()) {
@@ -207,7 +346,37 @@ public:
     return listOfEdges;
   }
 
-  std::vector<Tvertex> getTerminals() {
+  // For automata without zero edges, deterministic or not. Only local state is changed,
+  // so any number of threads may call it on one automaton.
+  template<typename Tword>
+  bool accepts(const Tword& word) const {
+    std::vector<Tvertex> currentVertices = {source_};
+    std::vector<Tvertex> adjacentVertices;
+    std::vector<bool> isVertexUsed(vertexCount(), false);
+    for (Tletter letter: word) {
+      adjacentVertices.clear();
+      for (auto vertex: currentVertices) {
+        for (const auto& edge: adjencyList_[vertex]) {
+          if (edge.letter == letter && !isVertexUsed[edge.finish]) {
+            isVertexUsed[edge.finish] = true;
+            adjacentVertices.push_back(edge.finish);
+          }
+        }
+      }
+      for (auto vertex: adjacentVertices) {
+        isVertexUsed[vertex] = false;
+      }
+      std::swap(currentVertices, adjacentVertices);
+    }
+    for (auto vertex: currentVertices) {
+      if (isTerminal_[vertex]) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::vector<Tvertex> getTerminals() const {
     std::vector<Tvertex> listOfTerminals;
     for (size_t vertex = 0; vertex < vertexCount(); ++vertex) {
       if (isTerminal_[vertex]) {
@@ -217,7 +386,7 @@ public:
     return listOfTerminals;
   }
 
-  std::string getHash() {
+  std::string getHash() const {
     auto answerEdges = getEdges();
     auto answerTerminals = getTerminals();
     std::string hashString = "";
@@ -241,36 +410,117 @@ public:
     return hashString;
   }
 
-  finiteAutomaton<Tvertex, Tletter> makeFull(std::vector<Tletter> alphabetLetters = defaultAlphabetLetters<Tletter>()) {
-    finiteAutomaton<Tvertex, Tletter> answer(adjencyList_, source_, isTerminal_);
-    answer.addVertex();
-    for (size_t vertex = 0; vertex < answer.vertexCount(); ++vertex) {
-      std::map<Tletter, bool> isLetterUsed;
-      for (auto adjacentEdgesIterator = answer.getBegin(vertex); adjacentEdgesIterator.valid(); adjacentEdgesIterator.next()) {
+  finiteAutomaton<Tvertex, Tletter, Tallocator> makeFull(std::vector<Tletter> alphabetLetters = defaultAlphabetLetters<Tletter>()) const& {
+    return copyWithAllocator(getAllocator()).makeFull(std::move(alphabetLetters));
+  }
+
+  finiteAutomaton<Tvertex, Tletter, Tallocator> makeFull(std::vector<Tletter> alphabetLetters = defaultAlphabetLetters<Tletter>()) && {
+    Tvertex sinkVertex = static_cast<Tvertex>(vertexCount());
+    addVertex();
+    std::map<Tletter, bool, std::less<Tletter>, Trebind<std::pair<const Tletter, bool>>> isLetterUsed(getAllocator());
+    for (size_t vertex = 0; vertex < vertexCount(); ++vertex) {
+      isLetterUsed.clear();
+      for (auto adjacentEdgesIterator = getBegin(vertex); adjacentEdgesIterator.valid(); adjacentEdgesIterator.next()) {
         isLetterUsed[adjacentEdgesIterator.getLetter()] = true;
       }
       for (Tletter letter: alphabetLetters) {
         if (!isLetterUsed[letter]) {
-          answer.insertEdge(static_cast<Tvertex>(vertex), static_cast<Tvertex>(vertexCount()), letter);
+          insertEdge(static_cast<Tvertex>(vertex), sinkVertex, letter);
         }
       }
     }
-    return answer;
+    return std::move(*this);
   }
 
-  finiteAutomaton<Tvertex, Tletter> negatate() {
-    std::vector<bool> answerTerminal = isTerminal_;
-    for (size_t vertex = 0; vertex < vertexCount(); ++vertex) {
-      answerTerminal[vertex] = !isTerminal_[vertex];
-    }
-    return finiteAutomaton(adjencyList_, source_, answerTerminal);
+  finiteAutomaton<Tvertex, Tletter, Tallocator> negatate() const& {
+    return copyWithAllocator(getAllocator()).negatate();
+  }
+
+  finiteAutomaton<Tvertex, Tletter, Tallocator> negatate() && {
+    isTerminal_.flip();
+    return std::move(*this);
+  }
+
+  finiteAutomaton<Tvertex, Tletter, Tallocator> minimize() const& {
+    finiteAutomaton_minimizer<Tvertex, Tletter, Tallocator> algorithmInstance(*this);
+    return algorithmInstance.execute();
+  }
+
+  finiteAutomaton<Tvertex, Tletter, Tallocator> minimize() && {
+    finiteAutomaton<Tvertex, Tletter, Tallocator> input(std::move(*this));
+    return input.minimize();
+  }
+
+  finiteAutomaton<Tvertex, Tletter, Tallocator> minimize(std::pmr::memory_resource* resource) const& {
+    return copyWithAllocator(TresourceAllocator(resource)).minimize().copyWithAllocator(getAllocator());
+  }
+
+  finiteAutomaton<Tvertex, Tletter, Tallocator> minimize(std::pmr::memory_resource* resource) && {
+    finiteAutomaton<Tvertex, Tletter, Tallocator> input(std::move(*this));
+    return input.minimize(resource);
+  }
+
+  finiteAutomaton<Tvertex, Tletter, Tallocator> minimize(finiteAutomaton_runControl& control) const& {
+    finiteAutomaton_minimizer<Tvertex, Tletter, Tallocator> algorithmInstance(*this, &control);
+    return algorithmInstance.execute();
+  }
+
+  finiteAutomaton<Tvertex, Tletter, Tallocator> minimize(finiteAutomaton_runControl& control) && {
+    finiteAutomaton<Tvertex, Tletter, Tallocator> input(std::move(*this));
+    return input.minimize(control);
   }
 
-  finiteAutomaton<Tvertex, Tletter> minimize() {
-    finiteAutomaton_minimizer<Tvertex, Tletter> algorithmInstance(*this);
+  // Moves the automaton into an immutable handle: every const method may be called from many threads at once.
+  std::shared_ptr<const finiteAutomaton<Tvertex, Tletter, Tallocator>> share() && {
+    return std::make_shared<const finiteAutomaton<Tvertex, Tletter, Tallocator>>(std::move(*this));
+  }
+
+  // Same language with fewer vertices, input must be without zero edges: useless vertices are removed,
+  // then vertices are merged by forward and backward bisimulation. Cheap enough to run before determine.
+  finiteAutomaton<Tvertex, Tletter, Tallocator> reduce() const& {
+    finiteAutomaton_reducer<Tvertex, Tletter, Tallocator> algorithmInstance(*this);
     return algorithmInstance.execute();
   }
 
+  finiteAutomaton<Tvertex, Tletter, Tallocator> reduce() && {
+    finiteAutomaton<Tvertex, Tletter, Tallocator> input(std::move(*this));
+    return input.reduce();
+  }
+
+  // eraseZeroEdges -> reduce -> makeFull -> determine -> minimize, every stage consuming the previous one.
+  finiteAutomaton<Tvertex, Tletter, Tallocator> compile(Tletter zeroLetter, 
+                                            std::vector<Tletter> alphabetLetters = defaultAlphabetLetters<Tletter>()) && {
+    return std::move(*this).eraseZeroEdges(zeroLetter).reduce().makeFull(std::move(alphabetLetters)).determine().minimize();
+  }
+
+  finiteAutomaton<Tvertex, Tletter, Tallocator> compile(Tletter zeroLetter, 
+                                            std::vector<Tletter> alphabetLetters = defaultAlphabetLetters<Tletter>()) const& {
+    return eraseZeroEdges(zeroLetter).reduce().makeFull(std::move(alphabetLetters)).determine().minimize();
+  }
+
+  // The whole pipeline, intermediate automata included, runs in resource and only the minimal automaton
+  // is copied back, so with a std::pmr::monotonic_buffer_resource per compilation everything else is released at once.
+  finiteAutomaton<Tvertex, Tletter, Tallocator> compile(Tletter zeroLetter, std::vector<Tletter> alphabetLetters, 
+                                            std::pmr::memory_resource* resource) && {
+    finiteAutomaton<Tvertex, Tletter, Tallocator> input(std::move(*this));
+    return input.compile(zeroLetter, std::move(alphabetLetters), resource);
+  }
+
+  finiteAutomaton<Tvertex, Tletter, Tallocator> compile(Tletter zeroLetter, std::vector<Tletter> alphabetLetters, 
+                                            std::pmr::memory_resource* resource) const& {
+    return copyWithAllocator(TresourceAllocator(resource)).compile(zeroLetter, std::move(alphabetLetters)).copyWithAllocator(getAllocator());
+  }
+
+  finiteAutomaton<Tvertex, Tletter, Tallocator> compile(Tletter zeroLetter, std::vector<Tletter> alphabetLetters, 
+                                            finiteAutomaton_runControl& control) && {
+    return std::move(*this).eraseZeroEdges(zeroLetter).reduce().makeFull(std::move(alphabetLetters)).determine(control).minimize(control);
+  }
+
+  finiteAutomaton<Tvertex, Tletter, Tallocator> compile(Tletter zeroLetter, std::vector<Tletter> alphabetLetters, 
+                                            finiteAutomaton_runControl& control) const& {
+    return eraseZeroEdges(zeroLetter).reduce().makeFull(std::move(alphabetLetters)).determine(control).minimize(control);
+  }
+
   class edgeWithStringAsLetter {
   public:
     std::string letter;
@@ -281,7 +531,13 @@ public:
       vertex(edgeVertex) {} 
   };
 
-  std::string getExpression() {
+  std::string getExpression() const {
+    finiteAutomaton_runControl control;
+    return getExpression(control);
+  }
+
+  // Vertices are eliminated one by one, control is checked before each of them.
+  std::string getExpression(finiteAutomaton_runControl& control) const {
     std::vector<std::vector<edgeWithStringAsLetter>> graph(vertexCount() + 1);
     for (size_t vertex = 0; vertex < vertexCount(); ++vertex) {
       for (auto adjacentEdgesIterator = getBegin(vertex); adjacentEdgesIterator.valid(); adjacentEdgesIterator.next()) {
@@ -295,6 +551,9 @@ public:
     }
     std::vector<bool> isVertexDeleted(graph.size(), false);
     for (size_t vertex = 0; vertex + 1 < graph.size(); ++vertex) {
+      if (control.shouldStop(vertex, graph.size() - 1 - vertex)) {
+        return "";
+      }
       if (static_cast<Tvertex>(vertex) == source_) {
         continue;
       }
@@ -426,14 +685,24 @@ public:
     return result;
   }
 
-  friend finiteAutomaton_determinator<Tvertex, Tletter>;
+  template<typename, typename, typename>
+  friend class finiteAutomaton_determinator;
 };
 
-
+// One compiled automaton shared by reference between threads, without copies or locks.
 template<typename Tvertex, typename Tletter>
+using finiteAutomaton_sharedHandle = std::shared_ptr<const finiteAutomaton<Tvertex, Tletter>>;
+
+
+template<typename Tvertex, typename Tletter, typename Tallocator>
 class finiteAutomaton_determinator {
 public: // Must be private, public only for easy-testing
-  using TvertexSubset = std::vector<Tvertex>;
+  template<typename Tvalue>
+  using Trebind = typename std::allocator_traits<Tallocator>::template rebind_alloc<Tvalue>;
+  using TvertexSubset = std::vector<Tvertex, Trebind<Tvertex>>;
+
+  template<typename Tvalue>
+  using TsubsetMap = std::map<TvertexSubset, Tvalue, std::less<TvertexSubset>, Trebind<std::pair<const TvertexSubset, Tvalue>>>;
   
   class subsetsGraphEdge {
   public:
@@ -441,7 +710,7 @@ public: // Must be private, public only for easy-testing
     Tletter letter;
 
     explicit subsetsGraphEdge(TvertexSubset adjacentVertex, Tletter sameLetter):
-      finish(adjacentVertex),
+      finish(std::move(adjacentVertex)),
       letter(sameLetter) {}
 
     bool operator<(const subsetsGraphEdge& anotherEdge) {
@@ -449,37 +718,49 @@ public: // Must be private, public only for easy-testing
     }
   };
 
-  std::map<TvertexSubset, std::vector<subsetsGraphEdge>> graph;
-  std::map<TvertexSubset, bool> isVertexTagged;
-  std::vector<TvertexSubset> arrayOfSubsets;
-  std::vector<TvertexSubset> terminals;
-  std::queue<TvertexSubset> subsetsQueue;
+  Tallocator allocator_;
+  TsubsetMap<std::vector<subsetsGraphEdge, Trebind<subsetsGraphEdge>>> graph;
+  TsubsetMap<bool> isVertexTagged;
+  std::vector<TvertexSubset, Trebind<TvertexSubset>> arrayOfSubsets;
+  std::vector<TvertexSubset, Trebind<TvertexSubset>> terminals;
+  std::queue<TvertexSubset, std::deque<TvertexSubset, Trebind<TvertexSubset>>> subsetsQueue;
 
-  finiteAutomaton<Tvertex, Tletter>& network_;
+  const finiteAutomaton<Tvertex, Tletter, Tallocator>& network_;
+  finiteAutomaton_runControl* control_;
 
-  explicit finiteAutomaton_determinator(finiteAutomaton<Tvertex, Tletter>& networkReference):
-    network_(networkReference) {} 
+  // Scratch memory and the answer come from the allocator of the network.
+  explicit finiteAutomaton_determinator(const finiteAutomaton<Tvertex, Tletter, Tallocator>& networkReference, finiteAutomaton_runControl* control = nullptr):
+    allocator_(networkReference.getAllocator()),
+    graph(allocator_),
+    isVertexTagged(allocator_),
+    arrayOfSubsets(allocator_),
+    terminals(allocator_),
+    subsetsQueue(allocator_),
+    network_(networkReference),
+    control_(control) {} 
 
-  finiteAutomaton<Tvertex, Tletter> getSubsetGraph() {
-    std::map<TvertexSubset, Tvertex> index;
-    std::vector<Tvertex> indexOfTerminals;
+  finiteAutomaton<Tvertex, Tletter, Tallocator> getSubsetGraph() {
+    TsubsetMap<Tvertex> index(allocator_);
     for (size_t position = 0; position < arrayOfSubsets.size(); ++position) {
       index[arrayOfSubsets[position]] = static_cast<Tvertex>(position);
     }
+    typename finiteAutomaton<Tvertex, Tletter, Tallocator>::TterminalFlags answerTerminal(arrayOfSubsets.size(), false, allocator_);
     for (size_t position = 0; position < terminals.size(); ++position) {
-      indexOfTerminals.push_back(index[terminals[position]]);
+      answerTerminal[index[terminals[position]]] = true;
     }
-    finiteAutomaton<Tvertex, Tletter> answer(arrayOfSubsets.size(), index[arrayOfSubsets[0]], indexOfTerminals);
-    for (auto adjacentEdgesIterator: graph) {
-      for (auto edge: adjacentEdgesIterator.second) {
+    finiteAutomaton<Tvertex, Tletter, Tallocator> answer(arrayOfSubsets.size(), index[arrayOfSubsets[0]], std::move(answerTerminal));
+    for (const auto& adjacentEdgesIterator: graph) {
+      for (const auto& edge: adjacentEdgesIterator.second) {
         answer.insertEdge(index[adjacentEdgesIterator.first], index[edge.finish], edge.letter);
       }
     }
     return answer;
   }
 
-  void searchEdges(TvertexSubset& vertex, TvertexSubset& adjacentVertex, size_t position, std::vector<std::vector<bool>>& isIndexUsed, 
-                   typename finiteAutomaton<Tvertex, Tletter>::OutgoingEdgesIterator& adjacentEdgesIterator) {
+  using TindexUsage = std::vector<std::vector<bool, Trebind<bool>>, Trebind<std::vector<bool, Trebind<bool>>>>;
+
+  void searchEdges(TvertexSubset& vertex, TvertexSubset& adjacentVertex, size_t position, TindexUsage& isIndexUsed, 
+                   typename finiteAutomaton<Tvertex, Tletter, Tallocator>::OutgoingEdgesIterator& adjacentEdgesIterator) {
     for (size_t innerPostion = position; innerPostion < vertex.size(); ++innerPostion) {
       size_t innerCounter = 0;
       for (auto innerAdjacentEdgesIterator = network_.getBegin(vertex[innerPostion]); 
@@ -495,16 +776,24 @@ public: // Must be private, public only for easy-testing
     }
   }
 
-  finiteAutomaton<Tvertex, Tletter> execute() {
-    arrayOfSubsets.push_back({network_.source_});
+  finiteAutomaton<Tvertex, Tletter, Tallocator> execute() {
+    arrayOfSubsets.push_back(TvertexSubset(1, network_.source_, allocator_));
     subsetsQueue.push(arrayOfSubsets[0]);
+    TindexUsage isIndexUsed(allocator_);
+    size_t processedCount = 0;
     while (!subsetsQueue.empty()) {
-      TvertexSubset vertex = subsetsQueue.front();
+      if (control_ != nullptr && control_->shouldStop(processedCount++, subsetsQueue.size())) {
+        return finiteAutomaton<Tvertex, Tletter, Tallocator>(1, static_cast<Tvertex>(0),
+            typename finiteAutomaton<Tvertex, Tletter, Tallocator>::TterminalFlags(1, false, allocator_));
+      }
+      TvertexSubset vertex = std::move(subsetsQueue.front());
       isVertexTagged[vertex] = true;
       subsetsQueue.pop();
-      std::vector<std::vector<bool>> isIndexUsed(vertex.size());
+      if (isIndexUsed.size() < vertex.size()) {
+        isIndexUsed.resize(vertex.size());
+      }
       for (size_t position = 0; position < vertex.size(); ++position) {
-        isIndexUsed[position].resize(network_.adjencyList_[vertex[position]].size(), false);
+        isIndexUsed[position].assign(network_.adjencyList_[vertex[position]].size(), false);
       }
       for (size_t position = 0; position < vertex.size(); ++position) {
         if (network_.isTerminal_[vertex[position]]) {
@@ -520,11 +809,11 @@ public: // Must be private, public only for easy-testing
             continue;
           }
           isIndexUsed[position][counter] = true;
-          TvertexSubset adjacentVertex = {adjacentEdgesIterator.getFinish()};
+          TvertexSubset adjacentVertex(1, adjacentEdgesIterator.getFinish(), allocator_);
           searchEdges(vertex, adjacentVertex, position, isIndexUsed, adjacentEdgesIterator);
           sort(adjacentVertex.begin(), adjacentVertex.end());
           adjacentVertex.erase(std::unique(adjacentVertex.begin(), adjacentVertex.end()), adjacentVertex.end());
-          graph[vertex].push_back(subsetsGraphEdge(adjacentVertex, adjacentEdgesIterator.getLetter()));
+          graph[vertex].push_back(subsetsGraphEdge(TvertexSubset(adjacentVertex, allocator_), adjacentEdgesIterator.getLetter()));
           if (!isVertexTagged[adjacentVertex]) {
             isVertexTagged[adjacentVertex] = true;
             arrayOfSubsets.push_back(adjacentVertex);
@@ -536,16 +825,367 @@ public: // Must be private, public only for easy-testing
     return getSubsetGraph();
   }
 
-  friend finiteAutomaton<Tvertex, Tletter>;
+  friend finiteAutomaton<Tvertex, Tletter, Tallocator>;
 };
 
-template<typename Tvertex, typename Tletter>
+// The coarsest partition of vertices refining the initial classes in which vertices of one class have edges by the same
+// letters into the same classes: the largest bisimulation, on a DFA exactly the equivalence of vertices.
+// Paige-Tarjan splitting instead of refinement rounds: every class lies in a compound class and is stable with respect
+// to all compound classes. A class B at most half of its compound S gets a compound of its own, then for every letter
+// classes are split by "has an edge into B" and by "has no edge into S \ B", the latter read from counters of edges
+// into S. A vertex moves to a new compound at most log n times, so m edges take O(m log m log n) time,
+// however many rounds Moore refinement would need (a{1,m} needs m of them).
+template<typename Tletter, typename Tallocator = std::allocator<int>>
+class finiteAutomaton_partitionRefiner {
+public: // Must be private, public only for easy-testing
+  template<typename Tvalue>
+  using Trebind = typename std::allocator_traits<Tallocator>::template rebind_alloc<Tvalue>;
+  template<typename Tvalue>
+  using Tvector = std::vector<Tvalue, Trebind<Tvalue>>;
+
+  class refinerEdge {
+  public:
+    int start;
+    int finish;
+    Tletter letter;
+    // Counts the edges by letter from start into the compound class of finish, shared by all of them.
+    int counter;
+
+    explicit refinerEdge(int startVertex, int finishVertex, Tletter edgeLetter):
+      start(startVertex),
+      finish(finishVertex),
+      letter(edgeLetter),
+      counter(-1) {}
+  };
+
+  Tallocator allocator_;
+  Tvector<int> initialClassNumber_;
+  int initialClassCount_;
+  Tvector<refinerEdge> edges_;
+  Tvector<int> incomingBegin_;
+  Tvector<int> incomingEdges_;
+  Tvector<int> counters_;
+  Tvector<int> freeCounters_;
+  // Vertices of a class are elements_[classBegin_, classEnd_), the marked ones go first, up to classMarkedEnd_.
+  Tvector<int> elements_;
+  Tvector<int> location_;
+  Tvector<int> classOf_;
+  Tvector<int> classBegin_;
+  Tvector<int> classEnd_;
+  Tvector<int> classMarkedEnd_;
+  Tvector<int> touchedClasses_;
+  // Classes of a compound form a list, compounds with two classes or more wait in splittableCompounds_.
+  Tvector<int> classCompound_;
+  Tvector<int> nextClass_;
+  Tvector<int> previousClass_;
+  Tvector<int> compoundFirstClass_;
+  Tvector<int> compoundClassCount_;
+  Tvector<int> splittableCompounds_;
+  Tvector<int> splitterEdges_;
+  Tvector<std::pair<int, int>> splitterCounters_;
+  Tvector<int> classNumber_;
+  int classCount_;
+
+  void linkClass(int classIndex, int compound) {
+    classCompound_[classIndex] = compound;
+    previousClass_[classIndex] = -1;
+    nextClass_[classIndex] = compoundFirstClass_[compound];
+    if (compoundFirstClass_[compound] != -1) {
+      previousClass_[compoundFirstClass_[compound]] = classIndex;
+    }
+    compoundFirstClass_[compound] = classIndex;
+    if (++compoundClassCount_[compound] == 2) {
+      splittableCompounds_.push_back(compound);
+    }
+  }
+
+  void unlinkClass(int classIndex) {
+    int compound = classCompound_[classIndex];
+    if (previousClass_[classIndex] != -1) {
+      nextClass_[previousClass_[classIndex]] = nextClass_[classIndex];
+    } else {
+      compoundFirstClass_[compound] = nextClass_[classIndex];
+    }
+    if (nextClass_[classIndex] != -1) {
+      previousClass_[nextClass_[classIndex]] = previousClass_[classIndex];
+    }
+    --compoundClassCount_[compound];
+  }
+
+  int addClass(int begin, int end, int compound) {
+    int classIndex = static_cast<int>(classBegin_.size());
+    classBegin_.push_back(begin);
+    classEnd_.push_back(end);
+    classMarkedEnd_.push_back(begin);
+    classCompound_.push_back(-1);
+    nextClass_.push_back(-1);
+    previousClass_.push_back(-1);
+    for (int position = begin; position < end; ++position) {
+      classOf_[elements_[position]] = classIndex;
+    }
+    linkClass(classIndex, compound);
+    return classIndex;
+  }
+
+  int addCompound() {
+    compoundFirstClass_.push_back(-1);
+    compoundClassCount_.push_back(0);
+    return static_cast<int>(compoundFirstClass_.size() - 1);
+  }
+
+  int addCounter() {
+    if (!freeCounters_.empty()) {
+      int counter = freeCounters_.back();
+      freeCounters_.pop_back();
+      return counter;
+    }
+    counters_.push_back(0);
+    return static_cast<int>(counters_.size() - 1);
+  }
+
+  void markVertex(int vertex) {
+    int classIndex = classOf_[vertex];
+    int position = location_[vertex];
+    if (position < classMarkedEnd_[classIndex]) {
+      return;
+    }
+    if (classMarkedEnd_[classIndex] == classBegin_[classIndex]) {
+      touchedClasses_.push_back(classIndex);
+    }
+    int markedPosition = classMarkedEnd_[classIndex]++;
+    std::swap(elements_[position], elements_[markedPosition]);
+    location_[elements_[position]] = position;
+    location_[elements_[markedPosition]] = markedPosition;
+  }
+
+  // The marked part of a partly marked class becomes a new class of the same compound.
+  void splitTouchedClasses() {
+    for (int classIndex: touchedClasses_) {
+      int begin = classBegin_[classIndex];
+      int markedEnd = classMarkedEnd_[classIndex];
+      classMarkedEnd_[classIndex] = begin;
+      if (markedEnd == classEnd_[classIndex]) {
+        continue;
+      }
+      classBegin_[classIndex] = markedEnd;
+      classMarkedEnd_[classIndex] = markedEnd;
+      addClass(begin, markedEnd, classCompound_[classIndex]);
+    }
+    touchedClasses_.clear();
+  }
+
+  template<typename TedgeLess>
+  void sortEdges(Tvector<int>& edgeIndices, TedgeLess&& isEdgeLess) const {
+    std::sort(edgeIndices.begin(), edgeIndices.end(), [&](int firstEdge, int secondEdge) {
+      return isEdgeLess(edges_[firstEdge], edges_[secondEdge]);
+    });
+  }
+
+  static bool isLetterStartLess(const refinerEdge& firstEdge, const refinerEdge& secondEdge) {
+    if (firstEdge.letter < secondEdge.letter || secondEdge.letter < firstEdge.letter) {
+      return firstEdge.letter < secondEdge.letter;
+    }
+    return firstEdge.start < secondEdge.start;
+  }
+
+  // Every vertex starts in the class of its initial number, all classes in one compound,
+  // and classes are made stable with respect to it: vertices with edges by a letter go apart from the rest.
+  void prepare() {
+    int vertexCount = static_cast<int>(initialClassNumber_.size());
+    Tvector<int> classSize(initialClassCount_ + 1, 0, allocator_);
+    for (int vertex = 0; vertex < vertexCount; ++vertex) {
+      assert(initialClassNumber_[vertex] >= 0 && initialClassNumber_[vertex] < initialClassCount_);
+      ++classSize[initialClassNumber_[vertex] + 1];
+    }
+    for (int initialClass = 0; initialClass < initialClassCount_; ++initialClass) {
+      classSize[initialClass + 1] += classSize[initialClass];
+    }
+    Tvector<int> fillPosition(classSize.begin(), classSize.end() - 1, allocator_);
+    elements_.assign(vertexCount, 0);
+    location_.assign(vertexCount, 0);
+    classOf_.assign(vertexCount, -1);
+    for (int vertex = 0; vertex < vertexCount; ++vertex) {
+      int position = fillPosition[initialClassNumber_[vertex]]++;
+      elements_[position] = vertex;
+      location_[vertex] = position;
+    }
+    int wholeCompound = addCompound();
+    for (int initialClass = 0; initialClass < initialClassCount_; ++initialClass) {
+      if (classSize[initialClass] < classSize[initialClass + 1]) {
+        addClass(classSize[initialClass], classSize[initialClass + 1], wholeCompound);
+      }
+    }
+    incomingBegin_.assign(vertexCount + 1, 0);
+    for (const auto& edge: edges_) {
+      ++incomingBegin_[edge.finish + 1];
+    }
+    for (int vertex = 0; vertex < vertexCount; ++vertex) {
+      incomingBegin_[vertex + 1] += incomingBegin_[vertex];
+    }
+    Tvector<int> edgeIndices(edges_.size(), 0, allocator_);
+    fillPosition.assign(incomingBegin_.begin(), incomingBegin_.end() - 1);
+    incomingEdges_.assign(edges_.size(), 0);
+    for (size_t edgeIndex = 0; edgeIndex < edges_.size(); ++edgeIndex) {
+      incomingEdges_[fillPosition[edges_[edgeIndex].finish]++] = static_cast<int>(edgeIndex);
+      edgeIndices[edgeIndex] = static_cast<int>(edgeIndex);
+    }
+    sortEdges(edgeIndices, isLetterStartLess);
+    for (size_t position = 0; position < edgeIndices.size(); ++position) {
+      refinerEdge& edge = edges_[edgeIndices[position]];
+      bool isNewLetter = (position == 0) || edges_[edgeIndices[position - 1]].letter < edge.letter;
+      bool isNewStart = isNewLetter || edges_[edgeIndices[position - 1]].start != edge.start;
+      if (isNewLetter && position > 0) {
+        splitTouchedClasses();
+      }
+      if (isNewStart) {
+        counters_.push_back(0);
+      }
+      edge.counter = static_cast<int>(counters_.size() - 1);
+      ++counters_[edge.counter];
+      markVertex(edge.start);
+    }
+    splitTouchedClasses();
+  }
+
+  // Moves splitterClass to a compound of its own and splits every class by the edges into it.
+  void splitBy(int splitterClass) {
+    unlinkClass(splitterClass);
+    linkClass(splitterClass, addCompound());
+    splitterEdges_.clear();
+    for (int position = classBegin_[splitterClass]; position < classEnd_[splitterClass]; ++position) {
+      int vertex = elements_[position];
+      splitterEdges_.insert(splitterEdges_.end(), incomingEdges_.begin() + incomingBegin_[vertex], incomingEdges_.begin() + incomingBegin_[vertex + 1]);
+    }
+    sortEdges(splitterEdges_, isLetterStartLess);
+    for (size_t letterBegin = 0; letterBegin < splitterEdges_.size();) {
+      size_t letterEnd = letterBegin;
+      splitterCounters_.clear();
+      for (; letterEnd < splitterEdges_.size() && edges_[splitterEdges_[letterEnd]].letter == edges_[splitterEdges_[letterBegin]].letter; ++letterEnd) {
+        refinerEdge& edge = edges_[splitterEdges_[letterEnd]];
+        if (splitterCounters_.empty() || splitterCounters_.back().first != edge.start) {
+          splitterCounters_.push_back({edge.start, edge.counter});
+        }
+        int splitterCounter = (letterEnd > letterBegin && edges_[splitterEdges_[letterEnd - 1]].start == edge.start)
+                            ? edges_[splitterEdges_[letterEnd - 1]].counter : addCounter();
+        --counters_[edge.counter];
+        ++counters_[splitterCounter];
+        edge.counter = splitterCounter;
+        markVertex(edge.start);
+      }
+      splitTouchedClasses();
+      for (const auto& [vertex, counter]: splitterCounters_) {
+        if (counters_[counter] == 0) {
+          markVertex(vertex);
+          freeCounters_.push_back(counter);
+        }
+      }
+      splitTouchedClasses();
+      letterBegin = letterEnd;
+    }
+  }
+
+  // The lowest vertex of every initial class keeps its number for its final class, as in Moore refinement;
+  // other classes get new numbers in the order of their lowest vertices.
+  void setClassNumbers() {
+    Tvector<int> numberOfClass(classBegin_.size(), -1, allocator_);
+    Tvector<bool> isInitialNumberUsed(initialClassCount_, false, allocator_);
+    for (size_t vertex = 0; vertex < classOf_.size(); ++vertex) {
+      if (!isInitialNumberUsed[initialClassNumber_[vertex]]) {
+        isInitialNumberUsed[initialClassNumber_[vertex]] = true;
+        numberOfClass[classOf_[vertex]] = initialClassNumber_[vertex];
+      }
+    }
+    classCount_ = initialClassCount_;
+    classNumber_.assign(classOf_.size(), 0);
+    for (size_t vertex = 0; vertex < classOf_.size(); ++vertex) {
+      if (numberOfClass[classOf_[vertex]] == -1) {
+        numberOfClass[classOf_[vertex]] = classCount_++;
+      }
+      classNumber_[vertex] = numberOfClass[classOf_[vertex]];
+    }
+  }
+
+public:
+  // Initial class numbers lie in [0, initialClassCount), a number may be unused.
+  template<typename TclassNumbers>
+  explicit finiteAutomaton_partitionRefiner(const TclassNumbers& initialClassNumber, int initialClassCount,
+                                            const Tallocator& allocator = Tallocator()):
+    allocator_(allocator),
+    initialClassNumber_(initialClassNumber.begin(), initialClassNumber.end(), allocator),
+    initialClassCount_(initialClassCount),
+    edges_(allocator), incomingBegin_(allocator), incomingEdges_(allocator), counters_(allocator), freeCounters_(allocator),
+    elements_(allocator), location_(allocator), classOf_(allocator), classBegin_(allocator), classEnd_(allocator),
+    classMarkedEnd_(allocator), touchedClasses_(allocator), classCompound_(allocator), nextClass_(allocator),
+    previousClass_(allocator), compoundFirstClass_(allocator), compoundClassCount_(allocator), splittableCompounds_(allocator),
+    splitterEdges_(allocator), splitterCounters_(allocator), classNumber_(allocator),
+    classCount_(initialClassCount) {}
+
+  void insertEdge(int startVertex, int finishVertex, Tletter letter) {
+    edges_.push_back(refinerEdge(startVertex, finishVertex, letter));
+  }
+
+  // Returns false if control stopped it, progress is (classes found, vertices not yet in classes of their own).
+  bool execute(finiteAutomaton_runControl* control = nullptr) {
+    prepare();
+    while (!splittableCompounds_.empty()) {
+      int compound = splittableCompounds_.back();
+      if (compoundClassCount_[compound] < 2) {
+        splittableCompounds_.pop_back();
+        continue;
+      }
+      size_t classCount = classBegin_.size();
+      if (control != nullptr && control->shouldStop(classCount, classOf_.size() - classCount)) {
+        return false;
+      }
+      int firstClass = compoundFirstClass_[compound];
+      int secondClass = nextClass_[firstClass];
+      bool isFirstSmaller = (classEnd_[firstClass] - classBegin_[firstClass] <= classEnd_[secondClass] - classBegin_[secondClass]);
+      splitBy(isFirstSmaller ? firstClass : secondClass);
+    }
+    setClassNumbers();
+    return true;
+  }
+
+  const Tvector<int>& getClassNumber() const {
+    return classNumber_;
+  }
+
+  int getClassCount() const {
+    return classCount_;
+  }
+};
+
+template<typename Tvertex, typename Tletter, typename Tallocator>
 class finiteAutomaton_minimizer {
 public:// Must be private, public only for easy-testing
-  finiteAutomaton<Tvertex, Tletter>& network_;
+  template<typename Tvalue>
+  using Trebind = typename std::allocator_traits<Tallocator>::template rebind_alloc<Tvalue>;
 
-  explicit finiteAutomaton_minimizer(finiteAutomaton<Tvertex, Tletter>& networkReference):
-    network_(networkReference) {} 
+  using TclassNumbers = std::vector<int, Trebind<int>>;
+
+  const finiteAutomaton<Tvertex, Tletter, Tallocator>& network_;
+  std::vector<int> initialClassNumber_;
+  Tallocator allocator_;
+  TclassNumbers classNumber_;
+  finiteAutomaton_runControl* control_;
+
+  // Scratch memory and the answer come from the allocator of the network.
+  explicit finiteAutomaton_minimizer(const finiteAutomaton<Tvertex, Tletter, Tallocator>& networkReference, finiteAutomaton_runControl* control = nullptr):
+    network_(networkReference),
+    allocator_(networkReference.getAllocator()),
+    classNumber_(allocator_),
+    control_(control) {} 
+
+  // Vertices with different initial classes are never merged, by default the classes are "terminal or not".
+  explicit finiteAutomaton_minimizer(const finiteAutomaton<Tvertex, Tletter, Tallocator>& networkReference, std::vector<int> initialClassNumber,
+                                     finiteAutomaton_runControl* control = nullptr):
+    network_(networkReference),
+    initialClassNumber_(std::move(initialClassNumber)),
+    allocator_(networkReference.getAllocator()),
+    classNumber_(allocator_),
+    control_(control) {
+      assert(initialClassNumber_.size() == network_.vertexCount());
+    } 
 
   class bidirectionalEdge {
   public:
@@ -563,15 +1203,15 @@ public:// Must be private, public only for easy-testing
     }
   };
 
-  finiteAutomaton<Tvertex, Tletter> getClassesGraph(std::vector<int> classNumber, int currentClassNumber) {
-    std::vector<bool> answerTerminal(currentClassNumber, false);
+  finiteAutomaton<Tvertex, Tletter, Tallocator> getClassesGraph(const TclassNumbers& classNumber, int currentClassNumber) {
+    typename finiteAutomaton<Tvertex, Tletter, Tallocator>::TterminalFlags answerTerminal(currentClassNumber, false, allocator_);
     for (size_t vertex = 0; vertex < classNumber.size(); ++vertex) {
       if (network_.isTerminal_[vertex]) {
         answerTerminal[classNumber[vertex]] = true;
       }
     }
-    finiteAutomaton<Tvertex, Tletter> answer(currentClassNumber, classNumber[network_.source_], answerTerminal);
-    std::map<bidirectionalEdge, bool> isEdgeUsed;
+    finiteAutomaton<Tvertex, Tletter, Tallocator> answer(currentClassNumber, classNumber[network_.source_], std::move(answerTerminal));
+    std::map<bidirectionalEdge, bool, std::less<bidirectionalEdge>, Trebind<std::pair<const bidirectionalEdge, bool>>> isEdgeUsed(allocator_);
     for (size_t vertex = 0; vertex < classNumber.size(); ++vertex) {
       for (auto adjacentEdgesIterator = network_.getBegin(vertex); adjacentEdgesIterator.valid(); adjacentEdgesIterator.next()) {
         auto currentEdge = bidirectionalEdge(classNumber[vertex], classNumber[adjacentEdgesIterator.getFinish()], adjacentEdgesIterator.getLetter());
@@ -587,67 +1227,178 @@ public:// Must be private, public only for easy-testing
     return answer;
   }
 
-  class monodirectionalEdge {
-  public:
-    Tletter letter;
-    int vertex;
+  // Classes are found by finiteAutomaton_partitionRefiner.
+  finiteAutomaton<Tvertex, Tletter, Tallocator> execute() {
+    int initialClassCount = 2;
+    TclassNumbers initialClassNumber(initialClassNumber_.begin(), initialClassNumber_.end(), allocator_);
+    if (initialClassNumber.empty()) {
+      initialClassNumber.assign(network_.vertexCount(), 0);
+      for (size_t vertex = 0; vertex < network_.vertexCount(); ++vertex) {
+        if (network_.isTerminal_[vertex]) {
+          initialClassNumber[vertex] = 1;
+        }
+      }
+    } else {
+      initialClassCount = 1 + *std::max_element(initialClassNumber.begin(), initialClassNumber.end());
+    }
+    finiteAutomaton_partitionRefiner<Tletter, Trebind<int>> refiner(initialClassNumber, initialClassCount, Trebind<int>(allocator_));
+    for (size_t vertex = 0; vertex < network_.vertexCount(); ++vertex) {
+      for (auto adjacentEdgesIterator = network_.getBegin(vertex); adjacentEdgesIterator.valid(); adjacentEdgesIterator.next()) {
+        refiner.insertEdge(static_cast<int>(vertex), static_cast<int>(adjacentEdgesIterator.getFinish()), adjacentEdgesIterator.getLetter());
+      }
+    }
+    if (!refiner.execute(control_)) {
+      return finiteAutomaton<Tvertex, Tletter, Tallocator>(1, static_cast<Tvertex>(0), typename finiteAutomaton<Tvertex, Tletter, Tallocator>::TterminalFlags(1, false, allocator_));
+    }
+    classNumber_.assign(refiner.getClassNumber().begin(), refiner.getClassNumber().end());
+    return getClassesGraph(classNumber_, refiner.getClassCount());
+  }
 
-    explicit monodirectionalEdge(Tletter edgeLetter, int edgeVertex):
-      letter(edgeLetter),
-      vertex(edgeVertex) {}
+  friend finiteAutomaton<Tvertex, Tletter, Tallocator>;
+};
+
+// Partition refinement by finiteAutomaton_partitionRefiner as in finiteAutomaton_minimizer, but on an NFA: vertices of
+// a class have edges by the same letters into the same classes. The coarsest such partition is a bisimulation,
+// merging its classes keeps the language: forward on the edges (classes start as terminal or not),
+// backward on the reversed edges (the source starts alone).
+template<typename Tvertex, typename Tletter, typename Tallocator>
+class finiteAutomaton_reducer {
+public:// Must be private, public only for easy-testing
+  template<typename Tvalue>
+  using Trebind = typename std::allocator_traits<Tallocator>::template rebind_alloc<Tvalue>;
+  using Tautomaton = finiteAutomaton<Tvertex, Tletter, Tallocator>;
+  using TvertexEdges = std::vector<std::pair<Tletter, Tvertex>, Trebind<std::pair<Tletter, Tvertex>>>;
+  using TadjacentEdges = std::vector<TvertexEdges, Trebind<TvertexEdges>>;
+  using TclassNumbers = std::vector<int, Trebind<int>>;
+  using TvertexFlags = std::vector<bool, Trebind<bool>>;
+  using TvertexList = std::vector<Tvertex, Trebind<Tvertex>>;
 
-    bool operator<(const monodirectionalEdge& anotherEdge) const {
-      return std::make_pair(letter, vertex) < std::make_pair(anotherEdge.letter, anotherEdge.vertex);
+  const Tautomaton& network_;
+  Tallocator allocator_;
+
+  // Scratch memory and the answer come from the allocator of the network.
+  explicit finiteAutomaton_reducer(const Tautomaton& networkReference):
+    network_(networkReference),
+    allocator_(networkReference.getAllocator()) {}
+
+  TadjacentEdges getAdjacentEdges(const Tautomaton& automaton, bool isReversed) const {
+    TadjacentEdges adjacentEdges(automaton.vertexCount(), TvertexEdges(allocator_), allocator_);
+    for (size_t vertex = 0; vertex < automaton.vertexCount(); ++vertex) {
+      for (const auto& edge: automaton.adjencyList_[vertex]) {
+        if (isReversed) {
+          adjacentEdges[edge.finish].push_back({edge.letter, edge.start});
+        } else {
+          adjacentEdges[edge.start].push_back({edge.letter, edge.finish});
+        }
+      }
     }
+    return adjacentEdges;
+  }
 
-    bool operator==(const monodirectionalEdge& anotherEdge) const {
-      return std::make_pair(letter, vertex) == std::make_pair(anotherEdge.letter, anotherEdge.vertex);
+  TvertexFlags getReachable(const TadjacentEdges& adjacentEdges, const TvertexList& startVertices) const {
+    TvertexFlags isReachable(adjacentEdges.size(), false, allocator_);
+    TvertexList verticesStack(allocator_);
+    for (auto vertex: startVertices) {
+      if (!isReachable[vertex]) {
+        isReachable[vertex] = true;
+        verticesStack.push_back(vertex);
+      }
     }
-  };
+    while (!verticesStack.empty()) {
+      Tvertex vertex = verticesStack.back();
+      verticesStack.pop_back();
+      for (const auto& edge: adjacentEdges[vertex]) {
+        if (!isReachable[edge.second]) {
+          isReachable[edge.second] = true;
+          verticesStack.push_back(edge.second);
+        }
+      }
+    }
+    return isReachable;
+  }
 
-  finiteAutomaton<Tvertex, Tletter> execute() {
-    std::vector<int> classNumber(network_.vertexCount(), 0);
+  // Keeps vertices reachable from the source and reaching a terminal, the source always stays.
+  Tautomaton getUsefulPart() const {
+    TvertexList terminals(allocator_);
     for (size_t vertex = 0; vertex < network_.vertexCount(); ++vertex) {
       if (network_.isTerminal_[vertex]) {
-        classNumber[vertex] = 1;
+        terminals.push_back(static_cast<Tvertex>(vertex));
       }
     }
-    auto oldClassNumber = classNumber;
-    int currentClassNumber = 2;
-    int numberOfIterations = network_.vertexCount();
-    while (numberOfIterations--) {
-      std::vector<std::vector<monodirectionalEdge>> adjacentEdges(classNumber.size());
-      for (size_t vertex = 0; vertex < classNumber.size(); ++vertex) {
-        for (auto adjacentEdgesIterator = network_.getBegin(vertex); adjacentEdgesIterator.valid(); adjacentEdgesIterator.next()) {
-          adjacentEdges[vertex].push_back(monodirectionalEdge(adjacentEdgesIterator.getLetter(), classNumber[adjacentEdgesIterator.getFinish()]));
-        }
-        std::sort(adjacentEdges[vertex].begin(), adjacentEdges[vertex].end());
-        adjacentEdges[vertex].erase(std::unique(adjacentEdges[vertex].begin(), adjacentEdges[vertex].end()), adjacentEdges[vertex].end());
-      }
-      bool checkIteration = false;
-      for (size_t vertex = 0; vertex < classNumber.size(); ++vertex) {
-        bool isFinded = false;
-        bool isConflict = false;
-        for (size_t adjacentVertex = 0; adjacentVertex < vertex; ++adjacentVertex) {
-          if ((adjacentEdges[adjacentVertex] == adjacentEdges[vertex]) && (oldClassNumber[adjacentVertex] == oldClassNumber[vertex])) {
-            isFinded = true;
-            classNumber[vertex] = classNumber[adjacentVertex];
-          } else if (classNumber[adjacentVertex] == classNumber[vertex]) {
-            isConflict = true;
-          }
-        }
-        if (!isFinded && isConflict) {
-          classNumber[vertex] = currentClassNumber++;
-          checkIteration = true;
+    TvertexFlags isUseful = getReachable(getAdjacentEdges(network_, false), TvertexList(1, network_.getSource(), allocator_));
+    TvertexFlags isCoreachable = getReachable(getAdjacentEdges(network_, true), terminals);
+    TclassNumbers classNumber(network_.vertexCount(), -1, allocator_);
+    int currentClassNumber = 0;
+    for (size_t vertex = 0; vertex < network_.vertexCount(); ++vertex) {
+      if ((isUseful[vertex] && isCoreachable[vertex]) || static_cast<Tvertex>(vertex) == network_.getSource()) {
+        classNumber[vertex] = currentClassNumber++;
+      }
+    }
+    return getQuotient(network_, classNumber, currentClassNumber);
+  }
+
+  // Classes are numbered in the order of their lowest vertices.
+  TclassNumbers getCoarsestPartition(const TadjacentEdges& adjacentEdges, const TclassNumbers& classNumber) const {
+    finiteAutomaton_partitionRefiner<Tletter, Trebind<int>> refiner(classNumber, 1 + *std::max_element(classNumber.begin(), classNumber.end()),
+                                                                    Trebind<int>(allocator_));
+    for (size_t vertex = 0; vertex < adjacentEdges.size(); ++vertex) {
+      for (const auto& edge: adjacentEdges[vertex]) {
+        refiner.insertEdge(static_cast<int>(vertex), static_cast<int>(edge.second), edge.first);
+      }
+    }
+    refiner.execute();
+    TclassNumbers denseNumber(refiner.getClassCount(), -1, allocator_);
+    TclassNumbers answer(classNumber.size(), 0, allocator_);
+    int currentClassNumber = 0;
+    for (size_t vertex = 0; vertex < classNumber.size(); ++vertex) {
+      int& number = denseNumber[refiner.getClassNumber()[vertex]];
+      if (number == -1) {
+        number = currentClassNumber++;
+      }
+      answer[vertex] = number;
+    }
+    return answer;
+  }
+
+  // A class is terminal if any of its vertices is, vertices with classNumber -1 are dropped.
+  Tautomaton getQuotient(const Tautomaton& automaton, const TclassNumbers& classNumber, int classCount) const {
+    Tautomaton answer(classCount, static_cast<Tvertex>(classNumber[automaton.getSource()]),
+                      typename Tautomaton::TterminalFlags(classCount, false, allocator_));
+    TadjacentEdges answerEdges(classCount, TvertexEdges(allocator_), allocator_);
+    for (size_t vertex = 0; vertex < automaton.vertexCount(); ++vertex) {
+      if (classNumber[vertex] == -1) {
+        continue;
+      }
+      if (automaton.isTerminal_[vertex]) {
+        answer.isTerminal_[classNumber[vertex]] = true;
+      }
+      for (const auto& edge: automaton.adjencyList_[vertex]) {
+        if (classNumber[edge.finish] != -1) {
+          answerEdges[classNumber[vertex]].push_back({edge.letter, static_cast<Tvertex>(classNumber[edge.finish])});
         }
       }
-      if (!checkIteration) {
-        break;
+    }
+    for (int vertex = 0; vertex < classCount; ++vertex) {
+      sort(answerEdges[vertex].begin(), answerEdges[vertex].end());
+      answerEdges[vertex].erase(std::unique(answerEdges[vertex].begin(), answerEdges[vertex].end()), answerEdges[vertex].end());
+      for (const auto& edge: answerEdges[vertex]) {
+        answer.insertEdge(static_cast<Tvertex>(vertex), edge.second, edge.first);
       }
-      oldClassNumber = classNumber;
     }
-    return getClassesGraph(classNumber, currentClassNumber);
+    return answer;
   }
 
-  friend finiteAutomaton<Tvertex, Tletter>;
+  Tautomaton execute() {
+    Tautomaton answer = getUsefulPart();
+    TclassNumbers forwardClassNumber(answer.vertexCount(), 0, allocator_);
+    for (size_t vertex = 0; vertex < answer.vertexCount(); ++vertex) {
+      forwardClassNumber[vertex] = answer.isTerminal_[vertex] ? 1 : 0;
+    }
+    forwardClassNumber = getCoarsestPartition(getAdjacentEdges(answer, false), forwardClassNumber);
+    answer = getQuotient(answer, forwardClassNumber, 1 + *std::max_element(forwardClassNumber.begin(), forwardClassNumber.end()));
+    TclassNumbers backwardClassNumber(answer.vertexCount(), 0, allocator_);
+    backwardClassNumber[answer.getSource()] = 1;
+    backwardClassNumber = getCoarsestPartition(getAdjacentEdges(answer, true), backwardClassNumber);
+    return getQuotient(answer, backwardClassNumber, 1 + *std::max_element(backwardClassNumber.begin(), backwardClassNumber.end()));
+  }
 };
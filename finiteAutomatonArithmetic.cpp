@@ -1,3 +1,4 @@
+#pragma once
 #include "finiteAutomaton.cpp"
 
 template<typename Tvertex, typename Tletter>
@@ -83,3 +84,89 @@ finiteAutomaton<Tvertex, Tletter> closure(finiteAutomaton<Tvertex, Tletter> base
   answer.insertEdge(answerTerminal, answerSource, zeroLetter);
   return answer;
 }
+
+template<typename Tvertex, typename Tletter>
+finiteAutomaton<Tvertex, Tletter> reversal(finiteAutomaton<Tvertex, Tletter> base,
+                                      Tletter zeroLetter = defaultZeroLetter<Tletter>()) {  
+  Tvertex answerSource = static_cast<Tvertex>(base.vertexCount());
+  finiteAutomaton<Tvertex, Tletter> answer(1 + base.vertexCount(), answerSource, std::vector<Tvertex>({base.getSource()}));
+  using TEdge = typename finiteAutomaton<Tvertex, Tletter>::Edge;
+  std::vector<TEdge> baseEdges = base.getEdges();
+  std::vector<Tvertex> baseTerminals = base.getTerminals();
+  for (auto edge: baseEdges) {
+    answer.insertEdge(edge.finish, edge.start, edge.letter);
+  }
+  for (auto terminalVertex: baseTerminals) {
+    answer.insertEdge(answerSource, terminalVertex, zeroLetter);
+  }
+  return answer;
+}
+
+const size_t unboundedRepetition = static_cast<size_t>(-1);
+
+// The same language without the empty word, the result has no zero edges: a fresh source copies the edges
+// of the old one and is never terminal, so only the empty path ends in it.
+template<typename Tvertex, typename Tletter>
+finiteAutomaton<Tvertex, Tletter> withoutEmptyWord(finiteAutomaton<Tvertex, Tletter> base,
+                                                   Tletter zeroLetter = defaultZeroLetter<Tletter>()) {
+  base = std::move(base).eraseZeroEdges(zeroLetter);
+  Tvertex answerSource = static_cast<Tvertex>(base.vertexCount());
+  std::vector<bool> answerTerminal(base.isTerminal_.begin(), base.isTerminal_.end());
+  answerTerminal.push_back(false);
+  finiteAutomaton<Tvertex, Tletter> answer(base.vertexCount() + 1, answerSource, std::move(answerTerminal));
+  for (auto edge: base.getEdges()) {
+    answer.insertEdge(edge.start, edge.finish, edge.letter);
+    if (edge.start == base.getSource()) {
+      answer.insertEdge(answerSource, edge.finish, edge.letter);
+    }
+  }
+  return answer;
+}
+
+// base{minCount,maxCount} built directly from max(minCount, maxCount) copies of base (minCount + 1 copies
+// at most if unbounded). Every copy from minCount - 1 on has its own exit to the terminal instead of
+// nested optional parts. If base accepts the empty word, base{n,m} = (base without it){0,m}, so base is never
+// nullable here: an eps-closure never passes a whole copy, and the size and the eps-closures stay linear in the number of copies.
+// A DFA of base{n,m} needs about m * |DFA of base| vertices anyway, so the bound still counts, but only linearly:
+// reduce and minimize refine in O(m log m log n) with finiteAutomaton_partitionRefiner, not in m rounds.
+template<typename Tvertex, typename Tletter>
+finiteAutomaton<Tvertex, Tletter> repetition(finiteAutomaton<Tvertex, Tletter> base, size_t minCount, size_t maxCount,
+                                      Tletter zeroLetter = defaultZeroLetter<Tletter>()) {  
+  assert(minCount <= maxCount);
+  if (base.eraseZeroEdges(zeroLetter).isTerminal_[base.getSource()]) {
+    base = withoutEmptyWord(std::move(base), zeroLetter);
+    minCount = 0;
+  }
+  bool isUnbounded = (maxCount == unboundedRepetition);
+  size_t copyCount = isUnbounded ? std::max<size_t>(minCount, 1) : maxCount;
+  Tvertex answerSource = static_cast<Tvertex>(0);
+  Tvertex answerTerminal = static_cast<Tvertex>(1);
+  finiteAutomaton<Tvertex, Tletter> answer(2 + copyCount * base.vertexCount(), answerSource, std::vector<Tvertex>({answerTerminal}));
+  using TEdge = typename finiteAutomaton<Tvertex, Tletter>::Edge;
+  std::vector<TEdge> baseEdges = base.getEdges();
+  std::vector<Tvertex> baseTerminals = base.getTerminals();
+  if (minCount == 0) {
+    answer.insertEdge(answerSource, answerTerminal, zeroLetter);
+  }
+  if (copyCount == 0) {
+    return answer;
+  }
+  answer.insertEdge(answerSource, base.getSource() + static_cast<Tvertex>(2), zeroLetter);
+  for (size_t copy = 0; copy < copyCount; ++copy) {
+    Tvertex shift = static_cast<Tvertex>(2 + copy * base.vertexCount());
+    Tvertex nextSource = (copy + 1 < copyCount) ? base.getSource() + shift + static_cast<Tvertex>(base.vertexCount()) 
+                                                : base.getSource() + shift;
+    for (auto edge: baseEdges) {
+      answer.insertEdge(edge.start + shift, edge.finish + shift, edge.letter);
+    }
+    for (auto terminalVertex: baseTerminals) {
+      if (copy + 1 < copyCount || isUnbounded) {
+        answer.insertEdge(terminalVertex + shift, nextSource, zeroLetter);
+      }
+      if (copy + 1 >= minCount) {
+        answer.insertEdge(terminalVertex + shift, answerTerminal, zeroLetter);
+      }
+    }
+  }
+  return answer;
+}
@@ -0,0 +1,250 @@
+#pragma once
+#include "finiteAutomaton.cpp"
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+// Builds the minimal complete DFA of an RPN pattern (the syntax of maxSingleSubstringFinder) inside
+// constant evaluation. Vertex 0 of every intermediate DFA is the dead vertex, letters absent from the pattern lead there.
+template<size_t MaxStates, size_t PatternSize>
+class finiteAutomaton_compileTime {
+public:
+  static constexpr size_t maxLetterClasses = PatternSize + 1;
+  static constexpr size_t maxNfaVertices = 2 * PatternSize + 2;
+  static constexpr size_t maxNfaEdges = 4 * PatternSize + 4;
+  static constexpr size_t subsetWords = (maxNfaVertices + 63) / 64;
+  static constexpr int zeroLetterClass = -1;
+
+  using TvertexSubset = std::array<uint64_t, subsetWords>;
+  using TtransitionRow = std::array<int, maxLetterClasses>;
+
+  std::array<int, 256> letterClass_{};
+  std::array<char, maxLetterClasses> classLetter_{};
+  size_t classCount_ = 1;
+  std::array<TtransitionRow, MaxStates> transitions_{};
+  std::array<bool, MaxStates> isTerminal_{};
+  size_t vertexCount_ = 0;
+  int source_ = 0;
+
+public: // Must be private, public only for easy-testing
+  class thompsonAutomaton {
+  public:
+    std::array<int, maxNfaEdges> edgeStart{};
+    std::array<int, maxNfaEdges> edgeFinish{};
+    std::array<int, maxNfaEdges> edgeLetterClass{};
+    size_t edgeCount = 0;
+    size_t vertexCount = 0;
+    int source = 0;
+    int terminal = 0;
+
+    constexpr int addVertex() {
+      assert(vertexCount < maxNfaVertices);
+      return static_cast<int>(vertexCount++);
+    }
+
+    constexpr void insertEdge(int startVertex, int finishVertex, int letterClass) {
+      assert(edgeCount < maxNfaEdges);
+      edgeStart[edgeCount] = startVertex;
+      edgeFinish[edgeCount] = finishVertex;
+      edgeLetterClass[edgeCount] = letterClass;
+      ++edgeCount;
+    }
+  };
+
+  static constexpr bool contains(const TvertexSubset& subset, int vertex) {
+    return (subset[vertex / 64] >> (vertex % 64)) & 1;
+  }
+
+  static constexpr void insert(TvertexSubset& subset, int vertex) {
+    subset[vertex / 64] |= static_cast<uint64_t>(1) << (vertex % 64);
+  }
+
+  static constexpr bool isEqual(const TvertexSubset& firstSubset, const TvertexSubset& secondSubset) {
+    for (size_t word = 0; word < subsetWords; ++word) {
+      if (firstSubset[word] != secondSubset[word]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static constexpr TvertexSubset getZeroClosure(const thompsonAutomaton& nfa, TvertexSubset subset) {
+    bool isChanged = true;
+    while (isChanged) {
+      isChanged = false;
+      for (size_t edge = 0; edge < nfa.edgeCount; ++edge) {
+        if (nfa.edgeLetterClass[edge] == zeroLetterClass && contains(subset, nfa.edgeStart[edge]) &&
+            !contains(subset, nfa.edgeFinish[edge])) {
+          insert(subset, nfa.edgeFinish[edge]);
+          isChanged = true;
+        }
+      }
+    }
+    return subset;
+  }
+
+  constexpr int getLetterClass(char letter) {
+    int& answer = letterClass_[static_cast<unsigned char>(letter)];
+    if (answer == 0) {
+      classLetter_[classCount_] = letter;
+      answer = static_cast<int>(classCount_++);
+    }
+    return answer;
+  }
+
+  constexpr thompsonAutomaton getThompsonAutomaton(const char (&pattern)[PatternSize]) {
+    thompsonAutomaton nfa;
+    std::array<int, PatternSize> fragmentSource{};
+    std::array<int, PatternSize> fragmentTerminal{};
+    size_t stackSize = 0;
+    for (size_t position = 0; position < PatternSize && pattern[position] != '\0'; ++position) {
+      char letter = pattern[position];
+      if (letter == '*') {
+        assert(stackSize >= 1);
+        int answerSource = nfa.addVertex();
+        nfa.insertEdge(answerSource, fragmentSource[stackSize - 1], zeroLetterClass);
+        nfa.insertEdge(fragmentTerminal[stackSize - 1], answerSource, zeroLetterClass);
+        fragmentSource[stackSize - 1] = answerSource;
+        fragmentTerminal[stackSize - 1] = answerSource;
+        continue;
+      }
+      if (letter == '+') {
+        assert(stackSize >= 2);
+        int answerSource = nfa.addVertex();
+        int answerTerminal = nfa.addVertex();
+        for (size_t term = stackSize - 2; term < stackSize; ++term) {
+          nfa.insertEdge(answerSource, fragmentSource[term], zeroLetterClass);
+          nfa.insertEdge(fragmentTerminal[term], answerTerminal, zeroLetterClass);
+        }
+        --stackSize;
+        fragmentSource[stackSize - 1] = answerSource;
+        fragmentTerminal[stackSize - 1] = answerTerminal;
+        continue;
+      }
+      if (letter == '.') {
+        assert(stackSize >= 2);
+        nfa.insertEdge(fragmentTerminal[stackSize - 2], fragmentSource[stackSize - 1], zeroLetterClass);
+        fragmentTerminal[stackSize - 2] = fragmentTerminal[stackSize - 1];
+        --stackSize;
+        continue;
+      }
+      int answerSource = nfa.addVertex();
+      int answerTerminal = nfa.addVertex();
+      nfa.insertEdge(answerSource, answerTerminal, (letter == '1') ? zeroLetterClass : getLetterClass(letter));
+      fragmentSource[stackSize] = answerSource;
+      fragmentTerminal[stackSize] = answerTerminal;
+      ++stackSize;
+    }
+    assert(stackSize == 1);
+    nfa.source = fragmentSource[0];
+    nfa.terminal = fragmentTerminal[0];
+    return nfa;
+  }
+
+  constexpr void determine(const thompsonAutomaton& nfa) {
+    std::array<TvertexSubset, MaxStates> subsets{};
+    TvertexSubset sourceSubset{};
+    insert(sourceSubset, nfa.source);
+    subsets[1] = getZeroClosure(nfa, sourceSubset);
+    vertexCount_ = 2;
+    source_ = 1;
+    for (size_t vertex = 0; vertex < vertexCount_; ++vertex) {
+      isTerminal_[vertex] = contains(subsets[vertex], nfa.terminal);
+      for (size_t letterClass = 1; letterClass < classCount_; ++letterClass) {
+        TvertexSubset adjacentSubset{};
+        for (size_t edge = 0; edge < nfa.edgeCount; ++edge) {
+          if (nfa.edgeLetterClass[edge] == static_cast<int>(letterClass) && contains(subsets[vertex], nfa.edgeStart[edge])) {
+            insert(adjacentSubset, nfa.edgeFinish[edge]);
+          }
+        }
+        adjacentSubset = getZeroClosure(nfa, adjacentSubset);
+        size_t adjacentVertex = 0;
+        while (adjacentVertex < vertexCount_ && !isEqual(subsets[adjacentVertex], adjacentSubset)) {
+          ++adjacentVertex;
+        }
+        if (adjacentVertex == vertexCount_) {
+          assert(vertexCount_ < MaxStates);
+          subsets[vertexCount_++] = adjacentSubset;
+        }
+        transitions_[vertex][letterClass] = static_cast<int>(adjacentVertex);
+      }
+    }
+  }
+
+  constexpr void minimize() {
+    std::array<int, MaxStates> classNumber{};
+    std::array<int, MaxStates> newClassNumber{};
+    for (size_t vertex = 0; vertex < vertexCount_; ++vertex) {
+      classNumber[vertex] = isTerminal_[vertex] ? 1 : 0;
+    }
+    size_t currentClassNumber = 0;
+    while (true) {
+      size_t newCurrentClassNumber = 0;
+      for (size_t vertex = 0; vertex < vertexCount_; ++vertex) {
+        size_t sameVertex = 0;
+        bool isFinded = false;
+        for (; sameVertex < vertex && !isFinded; ++sameVertex) {
+          bool isSame = (classNumber[sameVertex] == classNumber[vertex]);
+          for (size_t letterClass = 1; letterClass < classCount_ && isSame; ++letterClass) {
+            isSame = (classNumber[transitions_[sameVertex][letterClass]] == classNumber[transitions_[vertex][letterClass]]);
+          }
+          isFinded = isSame;
+        }
+        newClassNumber[vertex] = isFinded ? newClassNumber[sameVertex - 1] : static_cast<int>(newCurrentClassNumber++);
+      }
+      classNumber = newClassNumber;
+      if (newCurrentClassNumber == currentClassNumber) {
+        break;
+      }
+      currentClassNumber = newCurrentClassNumber;
+    }
+    std::array<TtransitionRow, MaxStates> answerTransitions{};
+    std::array<bool, MaxStates> answerTerminal{};
+    for (size_t vertex = 0; vertex < vertexCount_; ++vertex) {
+      for (size_t letterClass = 0; letterClass < classCount_; ++letterClass) {
+        answerTransitions[classNumber[vertex]][letterClass] = classNumber[transitions_[vertex][letterClass]];
+      }
+      answerTerminal[classNumber[vertex]] = isTerminal_[vertex];
+    }
+    transitions_ = answerTransitions;
+    isTerminal_ = answerTerminal;
+    source_ = classNumber[source_];
+    vertexCount_ = currentClassNumber;
+  }
+
+public:
+  constexpr explicit finiteAutomaton_compileTime(const char (&pattern)[PatternSize]) {
+    thompsonAutomaton nfa = getThompsonAutomaton(pattern);
+    determine(nfa);
+    minimize();
+  }
+
+  constexpr size_t vertexCount() const {
+    return vertexCount_;
+  }
+
+  constexpr bool accepts(std::string_view word) const {
+    int vertex = source_;
+    for (char letter: word) {
+      vertex = transitions_[vertex][letterClass_[static_cast<unsigned char>(letter)]];
+    }
+    return isTerminal_[vertex];
+  }
+
+  // The runtime automaton keeps the dead vertex, so it is complete over the letters of the pattern.
+  finiteAutomaton<int, char> toFiniteAutomaton() const {
+    finiteAutomaton<int, char> answer(vertexCount_, source_, std::vector<bool>(isTerminal_.begin(), isTerminal_.begin() + vertexCount_));
+    for (size_t vertex = 0; vertex < vertexCount_; ++vertex) {
+      for (size_t letterClass = 1; letterClass < classCount_; ++letterClass) {
+        answer.insertEdge(static_cast<int>(vertex), transitions_[vertex][letterClass], classLetter_[letterClass]);
+      }
+    }
+    return answer;
+  }
+};
+
+// static constexpr auto automaton = compileRpnPattern("ab+*c."); MaxStates bounds the DFA before minimization.
+template<size_t MaxStates = 64, size_t PatternSize>
+constexpr finiteAutomaton_compileTime<MaxStates, PatternSize> compileRpnPattern(const char (&pattern)[PatternSize]) {
+  return finiteAutomaton_compileTime<MaxStates, PatternSize>(pattern);
+}
@@ -0,0 +1,198 @@
+#pragma once
+#include "finiteAutomaton.cpp"
+#include <cstdint>
+
+// The same transitions as finiteAutomaton_table in much less memory, for DFAs where most vertices share most transitions.
+// defaultRow_[letter] is the most frequent target of letter over all vertices. Only the transitions differing from it
+// are stored, rows of exceptions are packed into one array by row displacement: the exception of vertex by letter
+// lies at base_[vertex] + letter and is valid only if check_ there equals vertex. A step is two probes, not a search.
+template<typename Tvertex, typename Tletter>
+class finiteAutomaton_compressedTable {
+  static_assert(sizeof(Tletter) == 1, "finiteAutomaton_compressedTable is indexed by bytes, Tletter must be one byte wide");
+
+public: // Must be private, public only for easy-testing
+  static constexpr size_t tableWidth = 256;
+  static constexpr Tvertex noVertex = static_cast<Tvertex>(-1);
+  static constexpr size_t maxTriedBaseCount = 256;
+
+  std::vector<Tvertex> defaultRow_;
+  std::vector<uint32_t> base_;
+  std::vector<Tvertex> next_;
+  std::vector<Tvertex> check_;
+  std::vector<char> isTerminal_;
+  Tvertex source_;
+
+  // nextFreeCell_[cell] leads to the first free cell from cell on, a cell points to itself while it is free.
+  std::vector<size_t> nextFreeCell_;
+
+  void reserveCells(size_t cellCount) {
+    for (size_t cell = nextFreeCell_.size(); cell < cellCount; ++cell) {
+      nextFreeCell_.push_back(cell);
+    }
+  }
+
+  // Occupied runs are jumped over, and the path is compressed to the answer.
+  size_t findFreeCell(size_t cell) {
+    reserveCells(cell + 1);
+    size_t freeCell = cell;
+    while (nextFreeCell_[freeCell] != freeCell) {
+      freeCell = nextFreeCell_[freeCell];
+    }
+    while (cell != freeCell) {
+      size_t followingCell = nextFreeCell_[cell];
+      nextFreeCell_[cell] = freeCell;
+      cell = followingCell;
+    }
+    return freeCell;
+  }
+
+  void occupyCell(size_t cell) {
+    reserveCells(cell + 2);
+    nextFreeCell_[cell] = cell + 1;
+  }
+
+  // First fit, rows with more exceptions go first. Only bases putting the first letter of the row on a free cell are tried,
+  // found through nextFreeCell_, so filled parts of the table are jumped over instead of probed base by base.
+  // Still, in a dense table most of those bases fail, so the search starts at searchStart: when a row is not placed
+  // in maxTriedBaseCount tries, searchStart moves to where it gets placed, and it goes back to 0 only when rows get
+  // shorter, as shorter rows fit into the holes left behind. So a cell is passed once per row length (at most 256 times)
+  // plus maxTriedBaseCount tries per row, not once per row; the price is a somewhat longer table than exact first fit.
+  void packRows(const std::vector<std::vector<std::pair<size_t, Tvertex>>>& exceptions) {
+    std::vector<size_t> order(exceptions.size());
+    for (size_t vertex = 0; vertex < order.size(); ++vertex) {
+      order[vertex] = vertex;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t firstVertex, size_t secondVertex) {
+      return exceptions[firstVertex].size() > exceptions[secondVertex].size();
+    });
+    size_t searchStart = 0;
+    size_t searchStartRowSize = tableWidth + 1;
+    for (size_t vertex: order) {
+      const auto& row = exceptions[vertex];
+      if (row.empty()) {
+        break;
+      }
+      if (row.size() < searchStartRowSize) {
+        searchStart = 0;
+        searchStartRowSize = row.size();
+      }
+      size_t firstLetter = row.front().first;
+      size_t base = findFreeCell(searchStart + firstLetter) - firstLetter;
+      size_t triedBaseCount = 0;
+      while (true) {
+        if (check_.size() < base + tableWidth) {
+          check_.resize(base + tableWidth, noVertex);
+          next_.resize(base + tableWidth, noVertex);
+        }
+        bool isFree = true;
+        for (size_t position = 1; position < row.size() && isFree; ++position) {
+          isFree = (check_[base + row[position].first] == noVertex);
+        }
+        if (isFree) {
+          break;
+        }
+        base = findFreeCell(base + firstLetter + 1) - firstLetter;
+        ++triedBaseCount;
+      }
+      if (triedBaseCount >= maxTriedBaseCount) {
+        searchStart = base;
+      }
+      base_[vertex] = static_cast<uint32_t>(base);
+      for (const auto& exception: row) {
+        size_t cell = base + exception.first;
+        check_[cell] = static_cast<Tvertex>(vertex);
+        next_[cell] = exception.second;
+        occupyCell(cell);
+      }
+    }
+    std::vector<size_t>().swap(nextFreeCell_);
+    check_.resize(std::max(check_.size(), tableWidth), noVertex);
+    next_.resize(check_.size(), noVertex);
+  }
+
+public:
+  // As in finiteAutomaton_table, one extra dead vertex is appended and missing letters go there,
+  // or back to the source if isMissingLetterDead is false.
+  explicit finiteAutomaton_compressedTable(const finiteAutomaton<Tvertex, Tletter>& automaton, bool isMissingLetterDead = true):
+    defaultRow_(tableWidth),
+    base_(automaton.vertexCount() + 1, 0),
+    isTerminal_(automaton.vertexCount() + 1, false),
+    source_(automaton.getSource()) {
+      Tvertex deadVertex = static_cast<Tvertex>(automaton.vertexCount());
+      Tvertex missingVertex = isMissingLetterDead ? deadVertex : automaton.getSource();
+      // Dense rows would take as much memory as finiteAutomaton_table, so only edges are kept: a letter
+      // without an edge goes to missingVertex, every letter of the dead vertex goes to the dead vertex.
+      std::vector<std::vector<std::pair<size_t, Tvertex>>> rows(vertexCount());
+      std::vector<std::vector<Tvertex>> columns(tableWidth);
+      for (size_t vertex = 0; vertex < automaton.vertexCount(); ++vertex) {
+        isTerminal_[vertex] = automaton.isTerminal_[vertex];
+        for (auto adjacentEdgesIterator = automaton.getBegin(vertex); adjacentEdgesIterator.valid(); adjacentEdgesIterator.next()) {
+          size_t letterIndex = static_cast<unsigned char>(adjacentEdgesIterator.getLetter());
+          rows[vertex].push_back({letterIndex, adjacentEdgesIterator.getFinish()});
+          columns[letterIndex].push_back(adjacentEdgesIterator.getFinish());
+        }
+        std::sort(rows[vertex].begin(), rows[vertex].end());
+      }
+      for (size_t letterIndex = 0; letterIndex < tableWidth; ++letterIndex) {
+        auto& column = columns[letterIndex];
+        size_t missingCount = automaton.vertexCount() - column.size();
+        column.push_back(deadVertex);
+        std::sort(column.begin(), column.end());
+        size_t bestCount = 0;
+        for (size_t position = 0, sameCount = 0; position < column.size(); ++position) {
+          sameCount = (position > 0 && column[position] == column[position - 1]) ? sameCount + 1 : 1;
+          if (column[position] == missingVertex) {
+            sameCount += missingCount;
+            missingCount = 0;
+          }
+          if (sameCount > bestCount) {
+            bestCount = sameCount;
+            defaultRow_[letterIndex] = column[position];
+          }
+        }
+        if (missingCount > bestCount) {
+          defaultRow_[letterIndex] = missingVertex;
+        }
+        std::vector<Tvertex>().swap(column);
+      }
+      std::vector<std::vector<std::pair<size_t, Tvertex>>> exceptions(vertexCount());
+      for (size_t vertex = 0; vertex < vertexCount(); ++vertex) {
+        size_t position = 0;
+        for (size_t letterIndex = 0; letterIndex < tableWidth; ++letterIndex) {
+          Tvertex adjacentVertex = (static_cast<Tvertex>(vertex) == deadVertex) ? deadVertex : missingVertex;
+          if (position < rows[vertex].size() && rows[vertex][position].first == letterIndex) {
+            adjacentVertex = rows[vertex][position++].second;
+          }
+          if (adjacentVertex != defaultRow_[letterIndex]) {
+            exceptions[vertex].push_back({letterIndex, adjacentVertex});
+          }
+        }
+        std::vector<std::pair<size_t, Tvertex>>().swap(rows[vertex]);
+      }
+      packRows(exceptions);
+    }
+
+  size_t vertexCount() const {
+    return isTerminal_.size();
+  }
+
+  Tvertex getSource() const {
+    return source_;
+  }
+
+  bool isTerminal(Tvertex vertex) const {
+    return isTerminal_[vertex];
+  }
+
+  Tvertex step(Tvertex vertex, Tletter letter) const {
+    size_t letterIndex = static_cast<unsigned char>(letter);
+    size_t cell = base_[vertex] + letterIndex;
+    return (check_[cell] == vertex) ? next_[cell] : defaultRow_[letterIndex];
+  }
+
+  // Bytes taken by the transitions, to compare with vertexCount() * 256 * sizeof(Tvertex) of finiteAutomaton_table.
+  size_t memoryUsage() const {
+    return defaultRow_.size() * sizeof(Tvertex) + base_.size() * sizeof(uint32_t) +
+           (next_.size() + check_.size()) * sizeof(Tvertex) + isTerminal_.size();
+  }
+};
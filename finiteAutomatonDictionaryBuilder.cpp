@@ -0,0 +1,156 @@
+#pragma once
+#include "finiteAutomaton.cpp"
+#include <set>
+#include <tuple>
+#include <type_traits>
+
+// Incremental construction of the minimal acyclic DFA of a sorted list of words.
+// Only the path of the last inserted word is kept unminimized, every other vertex is
+// registered under (isTerminal, outgoing edges), and a new vertex equal to a registered one is replaced by it.
+template<typename Tvertex, typename Tletter>
+class finiteAutomaton_dictionaryBuilder {
+public: // Must be private, public only for easy-testing
+  using TvertexEdges = std::vector<std::pair<Tletter, Tvertex>>;
+
+  class dictionaryVertex {
+  public:
+    TvertexEdges edges;
+    bool isTerminal;
+
+    explicit dictionaryVertex(bool sameIsTerminal):
+      isTerminal(sameIsTerminal) {}
+
+    bool operator<(const dictionaryVertex& anotherVertex) const {
+      return std::tie(isTerminal, edges) < std::tie(anotherVertex.isTerminal, anotherVertex.edges);
+    }
+  };
+
+  class registerComparator {
+  public:
+    const std::vector<dictionaryVertex>* vertices;
+
+    explicit registerComparator(const std::vector<dictionaryVertex>* sameVertices):
+      vertices(sameVertices) {}
+
+    bool operator()(Tvertex firstVertex, Tvertex secondVertex) const {
+      return (*vertices)[firstVertex] < (*vertices)[secondVertex];
+    }
+  };
+
+  std::vector<dictionaryVertex> vertices_;
+  std::vector<Tvertex> freeVertices_;
+  std::set<Tvertex, registerComparator> register_;
+  std::vector<Tletter> previousWord_;
+  Tvertex source_;
+  bool isFinished_;
+
+  Tvertex addVertex() {
+    if (!freeVertices_.empty()) {
+      Tvertex vertex = freeVertices_.back();
+      freeVertices_.pop_back();
+      vertices_[vertex] = dictionaryVertex(false);
+      return vertex;
+    }
+    vertices_.push_back(dictionaryVertex(false));
+    return static_cast<Tvertex>(vertices_.size() - 1);
+  }
+
+  // Byte letters are compared as unsigned, like std::string does, so UTF-8 word lists sorted as strings are accepted.
+  static bool isLetterLess(Tletter firstLetter, Tletter secondLetter) {
+    if constexpr (std::is_integral_v<Tletter> && sizeof(Tletter) == 1) {
+      return static_cast<unsigned char>(firstLetter) < static_cast<unsigned char>(secondLetter);
+    } else {
+      return firstLetter < secondLetter;
+    }
+  }
+
+  void replaceOrRegister(Tvertex vertex) {
+    Tvertex child = vertices_[vertex].edges.back().second;
+    if (!vertices_[child].edges.empty()) {
+      replaceOrRegister(child);
+    }
+    auto registered = register_.find(child);
+    if (registered != register_.end()) {
+      vertices_[vertex].edges.back().second = *registered;
+      vertices_[child].edges.clear();
+      freeVertices_.push_back(child);
+    } else {
+      register_.insert(child);
+    }
+  }
+
+public:
+  finiteAutomaton_dictionaryBuilder():
+    register_(registerComparator(&vertices_)),
+    source_(0),
+    isFinished_(false) {
+      vertices_.push_back(dictionaryVertex(false));
+    }
+
+  finiteAutomaton_dictionaryBuilder(const finiteAutomaton_dictionaryBuilder&) = delete;
+  finiteAutomaton_dictionaryBuilder& operator=(const finiteAutomaton_dictionaryBuilder&) = delete;
+
+  // Words must come in non-decreasing lexicographic order, repeated words are ignored. A word less than
+  // the previous one would break minimality, so it is not inserted and false is returned.
+  template<typename Tword>
+  bool insertWord(const Tword& word) {
+    assert(!isFinished_);
+    std::vector<Tletter> currentWord(word.begin(), word.end());
+    if (std::lexicographical_compare(currentWord.begin(), currentWord.end(), previousWord_.begin(), previousWord_.end(), isLetterLess)) {
+      return false;
+    }
+    Tvertex vertex = source_;
+    size_t prefixLength = 0;
+    while (prefixLength < currentWord.size() && !vertices_[vertex].edges.empty() &&
+           vertices_[vertex].edges.back().first == currentWord[prefixLength]) {
+      vertex = vertices_[vertex].edges.back().second;
+      ++prefixLength;
+    }
+    if (!vertices_[vertex].edges.empty()) {
+      replaceOrRegister(vertex);
+    }
+    for (; prefixLength < currentWord.size(); ++prefixLength) {
+      Tvertex adjacentVertex = addVertex();
+      vertices_[vertex].edges.push_back({currentWord[prefixLength], adjacentVertex});
+      vertex = adjacentVertex;
+    }
+    vertices_[vertex].isTerminal = true;
+    previousWord_ = std::move(currentWord);
+    return true;
+  }
+
+  // Registers the last word, no words can be inserted afterwards. Vertices are numbered in BFS order
+  // from the source, edges of every vertex go in the order of the words.
+  finiteAutomaton<Tvertex, Tletter> getAutomaton() {
+    if (!isFinished_ && !vertices_[source_].edges.empty()) {
+      replaceOrRegister(source_);
+    }
+    isFinished_ = true;
+    std::vector<Tvertex> index(vertices_.size(), static_cast<Tvertex>(-1));
+    std::vector<Tvertex> order = {source_};
+    index[source_] = 0;
+    for (size_t position = 0; position < order.size(); ++position) {
+      for (const auto& edge: vertices_[order[position]].edges) {
+        if (index[edge.second] == static_cast<Tvertex>(-1)) {
+          index[edge.second] = static_cast<Tvertex>(order.size());
+          order.push_back(edge.second);
+        }
+      }
+    }
+    std::vector<bool> answerTerminal(order.size(), false);
+    for (size_t position = 0; position < order.size(); ++position) {
+      answerTerminal[position] = vertices_[order[position]].isTerminal;
+    }
+    finiteAutomaton<Tvertex, Tletter> answer(order.size(), index[source_], std::move(answerTerminal));
+    for (size_t position = 0; position < order.size(); ++position) {
+      for (const auto& edge: vertices_[order[position]].edges) {
+        answer.insertEdge(static_cast<Tvertex>(position), index[edge.second], edge.first);
+      }
+    }
+    return answer;
+  }
+
+  size_t vertexCount() const {
+    return vertices_.size() - freeVertices_.size();
+  }
+};
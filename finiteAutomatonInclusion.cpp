@@ -0,0 +1,170 @@
+#pragma once
+#include "finiteAutomaton.cpp"
+
+// Checks L(subset) ⊆ L(superset) for NFAs without zero edges (results of eraseZeroEdges), without determinizing superset.
+// Pairs (vertex of subset, set of vertices of superset) are explored in BFS order from the sources. A pair is
+// a counterexample if the vertex is terminal and the set has no terminals. A pair (v, S) is never explored
+// after a pair (v, T) with T ⊆ S: every word leading (v, S) to a counterexample leads (v, T) to one too.
+// So for every vertex only an antichain of minimal sets is kept.
+template<typename Tvertex, typename Tletter>
+class finiteAutomaton_inclusionChecker {
+public: // Must be private, public only for easy-testing
+  using TvertexEdges = std::vector<std::pair<Tletter, Tvertex>>;
+  using TvertexSubset = std::vector<Tvertex>;
+
+  class productVertex {
+  public:
+    Tvertex vertex;
+    TvertexSubset subset;
+    int parent;
+    Tletter letter;
+    bool isSubsumed;
+
+    explicit productVertex(Tvertex sameVertex, TvertexSubset sameSubset, int sameParent, Tletter sameLetter):
+      vertex(sameVertex),
+      subset(std::move(sameSubset)),
+      parent(sameParent),
+      letter(sameLetter),
+      isSubsumed(false) {}
+  };
+
+  std::vector<TvertexEdges> subsetEdges_;
+  std::vector<bool> subsetIsTerminal_;
+  Tvertex subsetSource_;
+  std::vector<TvertexEdges> supersetEdges_;
+  std::vector<bool> supersetIsTerminal_;
+  Tvertex supersetSource_;
+  std::vector<productVertex> productVertices_;
+  std::vector<std::vector<int>> antichain_;
+  std::vector<Tletter> counterexample_;
+
+  static void readAutomaton(const finiteAutomaton<Tvertex, Tletter>& automaton, std::vector<TvertexEdges>& edges, std::vector<bool>& isTerminal) {
+    edges.assign(automaton.vertexCount(), TvertexEdges());
+    isTerminal = automaton.isTerminal_;
+    for (size_t vertex = 0; vertex < automaton.vertexCount(); ++vertex) {
+      for (auto adjacentEdgesIterator = automaton.getBegin(vertex); adjacentEdgesIterator.valid(); adjacentEdgesIterator.next()) {
+        edges[vertex].push_back({adjacentEdgesIterator.getLetter(), adjacentEdgesIterator.getFinish()});
+      }
+      std::sort(edges[vertex].begin(), edges[vertex].end());
+      edges[vertex].erase(std::unique(edges[vertex].begin(), edges[vertex].end()), edges[vertex].end());
+    }
+  }
+
+  TvertexSubset getAdjacentSubset(const TvertexSubset& subset, Tletter letter) const {
+    TvertexSubset answer;
+    for (auto vertex: subset) {
+      auto finded = std::lower_bound(supersetEdges_[vertex].begin(), supersetEdges_[vertex].end(), std::make_pair(letter, static_cast<Tvertex>(0)),
+                                     [](const auto& firstEdge, const auto& secondEdge) { return firstEdge.first < secondEdge.first; });
+      for (; finded != supersetEdges_[vertex].end() && finded->first == letter; ++finded) {
+        answer.push_back(finded->second);
+      }
+    }
+    std::sort(answer.begin(), answer.end());
+    answer.erase(std::unique(answer.begin(), answer.end()), answer.end());
+    return answer;
+  }
+
+  bool isCounterexample(const productVertex& current) const {
+    if (!subsetIsTerminal_[current.vertex]) {
+      return false;
+    }
+    for (auto vertex: current.subset) {
+      if (supersetIsTerminal_[vertex]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Returns false if the pair is subsumed, otherwise drops the pairs it subsumes from the antichain.
+  bool insertIntoAntichain(int index) {
+    const productVertex& current = productVertices_[index];
+    auto& vertexAntichain = antichain_[current.vertex];
+    for (int sameIndex: vertexAntichain) {
+      const TvertexSubset& sameSubset = productVertices_[sameIndex].subset;
+      if (std::includes(current.subset.begin(), current.subset.end(), sameSubset.begin(), sameSubset.end())) {
+        return false;
+      }
+    }
+    size_t keptCount = 0;
+    for (int sameIndex: vertexAntichain) {
+      const TvertexSubset& sameSubset = productVertices_[sameIndex].subset;
+      if (std::includes(sameSubset.begin(), sameSubset.end(), current.subset.begin(), current.subset.end())) {
+        productVertices_[sameIndex].isSubsumed = true;
+      } else {
+        vertexAntichain[keptCount++] = sameIndex;
+      }
+    }
+    vertexAntichain.resize(keptCount);
+    vertexAntichain.push_back(index);
+    return true;
+  }
+
+  void setCounterexample(int index) {
+    counterexample_.clear();
+    for (; productVertices_[index].parent != -1; index = productVertices_[index].parent) {
+      counterexample_.push_back(productVertices_[index].letter);
+    }
+    std::reverse(counterexample_.begin(), counterexample_.end());
+  }
+
+public:
+  explicit finiteAutomaton_inclusionChecker(const finiteAutomaton<Tvertex, Tletter>& subsetAutomaton,
+                                            const finiteAutomaton<Tvertex, Tletter>& supersetAutomaton):
+    subsetSource_(subsetAutomaton.getSource()),
+    supersetSource_(supersetAutomaton.getSource()) {
+      readAutomaton(subsetAutomaton, subsetEdges_, subsetIsTerminal_);
+      readAutomaton(supersetAutomaton, supersetEdges_, supersetIsTerminal_);
+    }
+
+  // Universality of supersetAutomaton over alphabetLetters: the subset automaton is one terminal vertex with every loop.
+  explicit finiteAutomaton_inclusionChecker(const finiteAutomaton<Tvertex, Tletter>& supersetAutomaton,
+                                            std::vector<Tletter> alphabetLetters = defaultAlphabetLetters<Tletter>()):
+    subsetEdges_(1),
+    subsetIsTerminal_(1, true),
+    subsetSource_(0),
+    supersetSource_(supersetAutomaton.getSource()) {
+      std::sort(alphabetLetters.begin(), alphabetLetters.end());
+      alphabetLetters.erase(std::unique(alphabetLetters.begin(), alphabetLetters.end()), alphabetLetters.end());
+      for (Tletter letter: alphabetLetters) {
+        subsetEdges_[0].push_back({letter, static_cast<Tvertex>(0)});
+      }
+      readAutomaton(supersetAutomaton, supersetEdges_, supersetIsTerminal_);
+    }
+
+  // Returns true if the inclusion holds, otherwise stops at the first counterexample found.
+  bool execute() {
+    productVertices_.clear();
+    antichain_.assign(subsetEdges_.size(), std::vector<int>());
+    counterexample_.clear();
+    productVertices_.push_back(productVertex(subsetSource_, TvertexSubset({supersetSource_}), -1, Tletter()));
+    insertIntoAntichain(0);
+    for (size_t index = 0; index < productVertices_.size(); ++index) {
+      if (productVertices_[index].isSubsumed) {
+        continue;
+      }
+      if (isCounterexample(productVertices_[index])) {
+        setCounterexample(static_cast<int>(index));
+        return false;
+      }
+      Tvertex vertex = productVertices_[index].vertex;
+      for (const auto& edge: subsetEdges_[vertex]) {
+        TvertexSubset adjacentSubset = getAdjacentSubset(productVertices_[index].subset, edge.first);
+        productVertices_.push_back(productVertex(edge.second, std::move(adjacentSubset), static_cast<int>(index), edge.first));
+        if (!insertIntoAntichain(static_cast<int>(productVertices_.size() - 1))) {
+          productVertices_.pop_back();
+        }
+      }
+    }
+    return true;
+  }
+
+  // A word of L(subset) \ L(superset), valid after execute returned false.
+  const std::vector<Tletter>& getCounterexample() const {
+    return counterexample_;
+  }
+
+  size_t exploredCount() const {
+    return productVertices_.size();
+  }
+};
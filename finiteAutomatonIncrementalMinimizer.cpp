@@ -0,0 +1,423 @@
+#pragma once
+#include "finiteAutomaton.cpp"
+#include <set>
+#include <tuple>
+
+// A minimal DFA (without dead vertices, missing edges lead nowhere) that stays minimal under small edits.
+// An edit along a word copies only the path of that word, changes the last copy and registers the copies back to front:
+// successors of every copy are already unique, so it is equal to an existing vertex exactly when their
+// (isTerminal, outgoing edges) coincide, as in finiteAutomaton_dictionaryBuilder. Vertices no longer referenced are freed.
+// Reference counts miss unreachable cycles, so while the automaton has a cycle every edit also frees the vertices
+// unreachable from the source. An edit costs O(|word| log n) plus the size of the freed part, plus O(n) with cycles.
+template<typename Tvertex, typename Tletter>
+class finiteAutomaton_incrementalMinimizer {
+public: // Must be private, public only for easy-testing
+  using TvertexEdges = std::vector<std::pair<Tletter, Tvertex>>;
+
+  static constexpr Tvertex noVertex = static_cast<Tvertex>(-1);
+
+  class maintainedVertex {
+  public:
+    TvertexEdges edges;
+    bool isTerminal;
+    size_t referenceCount;
+
+    explicit maintainedVertex(bool sameIsTerminal):
+      isTerminal(sameIsTerminal),
+      referenceCount(0) {}
+
+    bool operator<(const maintainedVertex& anotherVertex) const {
+      return std::tie(isTerminal, edges) < std::tie(anotherVertex.isTerminal, anotherVertex.edges);
+    }
+
+    bool isEmpty() const {
+      return !isTerminal && edges.empty();
+    }
+  };
+
+  class registerComparator {
+  public:
+    const std::vector<maintainedVertex>* vertices;
+
+    explicit registerComparator(const std::vector<maintainedVertex>* sameVertices):
+      vertices(sameVertices) {}
+
+    bool operator()(Tvertex firstVertex, Tvertex secondVertex) const {
+      return (*vertices)[firstVertex] < (*vertices)[secondVertex];
+    }
+  };
+
+  std::vector<maintainedVertex> vertices_;
+  std::vector<Tvertex> freeVertices_;
+  std::set<Tvertex, registerComparator> register_;
+  // The source holds one reference, it may be the only empty vertex (the empty language).
+  Tvertex source_;
+  // False only if no cycle is reachable from the source, then reference counts alone free everything.
+  bool hasCycles_;
+
+  Tvertex addVertex(bool isTerminal) {
+    if (!freeVertices_.empty()) {
+      Tvertex vertex = freeVertices_.back();
+      freeVertices_.pop_back();
+      vertices_[vertex] = maintainedVertex(isTerminal);
+      return vertex;
+    }
+    vertices_.push_back(maintainedVertex(isTerminal));
+    return static_cast<Tvertex>(vertices_.size() - 1);
+  }
+
+  Tvertex copyVertex(Tvertex vertex) {
+    Tvertex answer = addVertex(vertices_[vertex].isTerminal);
+    vertices_[answer].edges = vertices_[vertex].edges;
+    for (const auto& edge: vertices_[answer].edges) {
+      ++vertices_[edge.second].referenceCount;
+    }
+    return answer;
+  }
+
+  bool isRegistered(Tvertex vertex) const {
+    auto registered = register_.find(vertex);
+    return registered != register_.end() && *registered == vertex;
+  }
+
+  void releaseVertex(Tvertex vertex) {
+    std::vector<Tvertex> releasedVertices = {vertex};
+    while (!releasedVertices.empty()) {
+      Tvertex currentVertex = releasedVertices.back();
+      releasedVertices.pop_back();
+      assert(vertices_[currentVertex].referenceCount > 0);
+      if (--vertices_[currentVertex].referenceCount > 0) {
+        continue;
+      }
+      if (isRegistered(currentVertex)) {
+        register_.erase(currentVertex);
+      }
+      for (const auto& edge: vertices_[currentVertex].edges) {
+        releasedVertices.push_back(edge.second);
+      }
+      vertices_[currentVertex].edges.clear();
+      freeVertices_.push_back(currentVertex);
+    }
+  }
+
+  // Frees the referenced vertices unreachable from the source (dead cycles and everything hanging from them)
+  // and finds out whether a cycle is still reachable. Free vertices are exactly the ones without references.
+  void collectCycles() {
+    if (!hasCycles_) {
+      return;
+    }
+    hasCycles_ = false;
+    // 0 - not visited, 1 - on the DFS stack, 2 - done.
+    std::vector<char> color(vertices_.size(), 0);
+    std::vector<std::pair<Tvertex, size_t>> verticesStack = {{source_, 0}};
+    color[source_] = 1;
+    while (!verticesStack.empty()) {
+      auto& [vertex, position] = verticesStack.back();
+      if (position == vertices_[vertex].edges.size()) {
+        color[vertex] = 2;
+        verticesStack.pop_back();
+        continue;
+      }
+      Tvertex adjacentVertex = vertices_[vertex].edges[position++].second;
+      if (color[adjacentVertex] == 1) {
+        hasCycles_ = true;
+      } else if (color[adjacentVertex] == 0) {
+        color[adjacentVertex] = 1;
+        verticesStack.push_back({adjacentVertex, 0});
+      }
+    }
+    std::vector<Tvertex> deadVertices;
+    for (size_t vertex = 0; vertex < vertices_.size(); ++vertex) {
+      if (color[vertex] == 0 && vertices_[vertex].referenceCount > 0) {
+        deadVertices.push_back(static_cast<Tvertex>(vertex));
+      }
+    }
+    // The register compares edges, so dead vertices leave it before any of them is cleared.
+    for (auto vertex: deadVertices) {
+      if (isRegistered(vertex)) {
+        register_.erase(vertex);
+      }
+    }
+    for (auto vertex: deadVertices) {
+      for (const auto& edge: vertices_[vertex].edges) {
+        if (color[edge.second] != 0) {
+          assert(vertices_[edge.second].referenceCount > 1);
+          --vertices_[edge.second].referenceCount;
+        }
+      }
+      vertices_[vertex].edges.clear();
+      vertices_[vertex].referenceCount = 0;
+      freeVertices_.push_back(vertex);
+    }
+  }
+
+  typename TvertexEdges::iterator findEdge(Tvertex vertex, Tletter letter) {
+    auto& edges = vertices_[vertex].edges;
+    return std::lower_bound(edges.begin(), edges.end(), std::make_pair(letter, static_cast<Tvertex>(0)),
+                            [](const auto& firstEdge, const auto& secondEdge) { return firstEdge.first < secondEdge.first; });
+  }
+
+  // Points the edge of an unregistered vertex by letter to finishVertex, noVertex erases the edge.
+  void setEdge(Tvertex vertex, Tletter letter, Tvertex finishVertex) {
+    assert(!isRegistered(vertex));
+    auto& edges = vertices_[vertex].edges;
+    auto finded = findEdge(vertex, letter);
+    bool isFinded = (finded != edges.end() && finded->first == letter);
+    Tvertex oldFinishVertex = isFinded ? finded->second : noVertex;
+    if (finishVertex != noVertex) {
+      ++vertices_[finishVertex].referenceCount;
+      if (isFinded) {
+        finded->second = finishVertex;
+      } else {
+        edges.insert(finded, {letter, finishVertex});
+      }
+    } else if (isFinded) {
+      edges.erase(finded);
+    }
+    if (oldFinishVertex != noVertex) {
+      releaseVertex(oldFinishVertex);
+    }
+  }
+
+  void setSource(Tvertex vertex) {
+    ++vertices_[vertex].referenceCount;
+    Tvertex oldSource = source_;
+    source_ = vertex;
+    releaseVertex(oldSource);
+  }
+
+  // Replaces the source and the vertices along word by unregistered copies, path[i] is reached by the first i letters.
+  // With isExtending missing edges get new empty vertices, otherwise the path stops at the first missing edge.
+  std::vector<Tvertex> copyPath(const std::vector<Tletter>& word, bool isExtending) {
+    setSource(copyVertex(source_));
+    std::vector<Tvertex> path = {source_};
+    for (Tletter letter: word) {
+      Tvertex vertex = path.back();
+      auto finded = findEdge(vertex, letter);
+      Tvertex adjacentVertex;
+      if (finded != vertices_[vertex].edges.end() && finded->first == letter) {
+        adjacentVertex = copyVertex(finded->second);
+      } else if (isExtending) {
+        adjacentVertex = addVertex(false);
+      } else {
+        break;
+      }
+      setEdge(vertex, letter, adjacentVertex);
+      path.push_back(adjacentVertex);
+    }
+    return path;
+  }
+
+  // Back to front: an empty copy is dropped, a copy equal to a registered vertex is replaced by it.
+  void registerPath(const std::vector<Tletter>& word, const std::vector<Tvertex>& path) {
+    for (size_t position = path.size(); position-- > 0;) {
+      Tvertex vertex = path[position];
+      Tvertex sameVertex = vertex;
+      if (vertices_[vertex].isEmpty()) {
+        sameVertex = (position > 0) ? noVertex : vertex;
+      } else {
+        auto registered = register_.find(vertex);
+        if (registered != register_.end()) {
+          sameVertex = *registered;
+        } else {
+          register_.insert(vertex);
+        }
+      }
+      if (sameVertex == vertex) {
+        continue;
+      }
+      if (position > 0) {
+        setEdge(path[position - 1], word[position - 1], sameVertex);
+      } else {
+        setSource(sameVertex);
+      }
+    }
+  }
+
+  template<typename Tword>
+  static std::vector<Tletter> getLetters(const Tword& word) {
+    return std::vector<Tletter>(word.begin(), word.end());
+  }
+
+  Tvertex getVertex(const std::vector<Tletter>& word) {
+    Tvertex vertex = source_;
+    for (Tletter letter: word) {
+      auto finded = findEdge(vertex, letter);
+      if (finded == vertices_[vertex].edges.end() || finded->first != letter) {
+        return noVertex;
+      }
+      vertex = finded->second;
+    }
+    return vertex;
+  }
+
+  void setTerminal(const std::vector<Tletter>& word, bool isTerminal) {
+    std::vector<Tvertex> path = copyPath(word, isTerminal);
+    if (path.size() == word.size() + 1) {
+      vertices_[path.back()].isTerminal = isTerminal;
+    }
+    registerPath(word, path);
+    collectCycles();
+  }
+
+public:
+  // The empty language.
+  finiteAutomaton_incrementalMinimizer():
+    register_(registerComparator(&vertices_)),
+    source_(0),
+    hasCycles_(false) {
+      vertices_.push_back(maintainedVertex(false));
+      vertices_[source_].referenceCount = 1;
+    }
+
+  // automaton must be deterministic, it is trimmed and minimized once here.
+  explicit finiteAutomaton_incrementalMinimizer(const finiteAutomaton<Tvertex, Tletter>& automaton):
+    finiteAutomaton_incrementalMinimizer() {
+      std::vector<std::vector<Tvertex>> reversedEdges(automaton.vertexCount());
+      for (size_t vertex = 0; vertex < automaton.vertexCount(); ++vertex) {
+        for (auto adjacentEdgesIterator = automaton.getBegin(vertex); adjacentEdgesIterator.valid(); adjacentEdgesIterator.next()) {
+          reversedEdges[adjacentEdgesIterator.getFinish()].push_back(static_cast<Tvertex>(vertex));
+        }
+      }
+      std::vector<bool> isCoreachable = automaton.isTerminal_;
+      std::vector<Tvertex> verticesStack = automaton.getTerminals();
+      while (!verticesStack.empty()) {
+        Tvertex vertex = verticesStack.back();
+        verticesStack.pop_back();
+        for (auto adjacentVertex: reversedEdges[vertex]) {
+          if (!isCoreachable[adjacentVertex]) {
+            isCoreachable[adjacentVertex] = true;
+            verticesStack.push_back(adjacentVertex);
+          }
+        }
+      }
+      if (!isCoreachable[automaton.getSource()]) {
+        return;
+      }
+      std::vector<Tvertex> index(automaton.vertexCount(), noVertex);
+      std::vector<Tvertex> order = {automaton.getSource()};
+      index[automaton.getSource()] = 0;
+      for (size_t position = 0; position < order.size(); ++position) {
+        for (auto adjacentEdgesIterator = automaton.getBegin(order[position]); adjacentEdgesIterator.valid(); adjacentEdgesIterator.next()) {
+          Tvertex adjacentVertex = adjacentEdgesIterator.getFinish();
+          if (isCoreachable[adjacentVertex] && index[adjacentVertex] == noVertex) {
+            index[adjacentVertex] = static_cast<Tvertex>(order.size());
+            order.push_back(adjacentVertex);
+          }
+        }
+      }
+      finiteAutomaton<Tvertex, Tletter> trimmed(order.size(), 0, std::vector<bool>(order.size(), false));
+      for (size_t position = 0; position < order.size(); ++position) {
+        trimmed.isTerminal_[position] = automaton.isTerminal_[order[position]];
+        for (auto adjacentEdgesIterator = automaton.getBegin(order[position]); adjacentEdgesIterator.valid(); adjacentEdgesIterator.next()) {
+          if (index[adjacentEdgesIterator.getFinish()] != noVertex) {
+            trimmed.insertEdge(static_cast<Tvertex>(position), index[adjacentEdgesIterator.getFinish()], adjacentEdgesIterator.getLetter());
+          }
+        }
+      }
+      finiteAutomaton<Tvertex, Tletter> minimal = std::move(trimmed).minimize();
+      vertices_.assign(minimal.vertexCount(), maintainedVertex(false));
+      for (size_t vertex = 0; vertex < minimal.vertexCount(); ++vertex) {
+        vertices_[vertex].isTerminal = minimal.isTerminal_[vertex];
+        for (auto adjacentEdgesIterator = minimal.getBegin(vertex); adjacentEdgesIterator.valid(); adjacentEdgesIterator.next()) {
+          vertices_[vertex].edges.push_back({adjacentEdgesIterator.getLetter(), adjacentEdgesIterator.getFinish()});
+          ++vertices_[adjacentEdgesIterator.getFinish()].referenceCount;
+        }
+        std::sort(vertices_[vertex].edges.begin(), vertices_[vertex].edges.end());
+      }
+      source_ = minimal.getSource();
+      ++vertices_[source_].referenceCount;
+      // minimize may leave an unreachable vertex for an empty initial class.
+      for (size_t vertex = 0; vertex < vertices_.size(); ++vertex) {
+        if (vertices_[vertex].referenceCount == 0) {
+          ++vertices_[vertex].referenceCount;
+          releaseVertex(static_cast<Tvertex>(vertex));
+        }
+      }
+      for (size_t vertex = 0; vertex < vertices_.size(); ++vertex) {
+        if (vertices_[vertex].referenceCount > 0) {
+          bool isInserted = register_.insert(static_cast<Tvertex>(vertex)).second;
+          assert(isInserted);
+        }
+      }
+      hasCycles_ = true;
+      collectCycles();
+    }
+
+  finiteAutomaton_incrementalMinimizer(const finiteAutomaton_incrementalMinimizer&) = delete;
+  finiteAutomaton_incrementalMinimizer& operator=(const finiteAutomaton_incrementalMinimizer&) = delete;
+
+  template<typename Tword>
+  void addWord(const Tword& word) {
+    setTerminal(getLetters(word), true);
+  }
+
+  template<typename Tword>
+  void removeWord(const Tword& word) {
+    setTerminal(getLetters(word), false);
+  }
+
+  // The vertex reached by word gets an edge by letter (replacing the old one) to the vertex that
+  // targetWord reached before the edit, so the new words are word + letter + (words accepted after targetWord).
+  template<typename Tword, typename TtargetWord>
+  void insertEdge(const Tword& word, Tletter letter, const TtargetWord& targetWord) {
+    std::vector<Tletter> letters = getLetters(word);
+    Tvertex targetVertex = getVertex(getLetters(targetWord));
+    assert(targetVertex != noVertex && !vertices_[targetVertex].isEmpty());
+    ++vertices_[targetVertex].referenceCount;
+    std::vector<Tvertex> path = copyPath(letters, true);
+    setEdge(path.back(), letter, targetVertex);
+    registerPath(letters, path);
+    releaseVertex(targetVertex);
+    hasCycles_ = true;
+    collectCycles();
+  }
+
+  template<typename Tword>
+  void eraseEdge(const Tword& word, Tletter letter) {
+    std::vector<Tletter> letters = getLetters(word);
+    std::vector<Tvertex> path = copyPath(letters, false);
+    if (path.size() == letters.size() + 1) {
+      setEdge(path.back(), letter, noVertex);
+    }
+    registerPath(letters, path);
+    collectCycles();
+  }
+
+  template<typename Tword>
+  bool contains(const Tword& word) {
+    Tvertex vertex = getVertex(getLetters(word));
+    return vertex != noVertex && vertices_[vertex].isTerminal;
+  }
+
+  size_t vertexCount() const {
+    return vertices_.size() - freeVertices_.size();
+  }
+
+  // Vertices are numbered in BFS order from the source, edges of every vertex go in letter order,
+  // so equal languages give equal automata.
+  finiteAutomaton<Tvertex, Tletter> getAutomaton() const {
+    std::vector<Tvertex> index(vertices_.size(), noVertex);
+    std::vector<Tvertex> order = {source_};
+    index[source_] = 0;
+    for (size_t position = 0; position < order.size(); ++position) {
+      for (const auto& edge: vertices_[order[position]].edges) {
+        if (index[edge.second] == noVertex) {
+          index[edge.second] = static_cast<Tvertex>(order.size());
+          order.push_back(edge.second);
+        }
+      }
+    }
+    std::vector<bool> answerTerminal(order.size(), false);
+    for (size_t position = 0; position < order.size(); ++position) {
+      answerTerminal[position] = vertices_[order[position]].isTerminal;
+    }
+    finiteAutomaton<Tvertex, Tletter> answer(order.size(), index[source_], std::move(answerTerminal));
+    for (size_t position = 0; position < order.size(); ++position) {
+      for (const auto& edge: vertices_[order[position]].edges) {
+        answer.insertEdge(static_cast<Tvertex>(position), index[edge.second], edge.first);
+      }
+    }
+    return answer;
+  }
+};
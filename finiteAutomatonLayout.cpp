@@ -0,0 +1,211 @@
+#pragma once
+#include "finiteAutomaton.cpp"
+
+enum class finiteAutomaton_layoutOrder {
+  bfs,
+  dfs
+};
+
+// How often every vertex and every edge of a DFA were passed while matching sample words.
+template<typename Tvertex, typename Tletter>
+class finiteAutomaton_profile {
+public: // Must be private, public only for easy-testing
+  std::vector<std::vector<std::pair<Tletter, Tvertex>>> edges_;
+  std::vector<std::vector<size_t>> transitionCount_;
+  std::vector<size_t> visitCount_;
+  Tvertex source_;
+
+public:
+  explicit finiteAutomaton_profile(const finiteAutomaton<Tvertex, Tletter>& automaton):
+    edges_(automaton.vertexCount()),
+    transitionCount_(automaton.vertexCount()),
+    visitCount_(automaton.vertexCount(), 0),
+    source_(automaton.getSource()) {
+      for (size_t vertex = 0; vertex < automaton.vertexCount(); ++vertex) {
+        for (auto adjacentEdgesIterator = automaton.getBegin(vertex); adjacentEdgesIterator.valid(); adjacentEdgesIterator.next()) {
+          edges_[vertex].push_back({adjacentEdgesIterator.getLetter(), adjacentEdgesIterator.getFinish()});
+        }
+        std::sort(edges_[vertex].begin(), edges_[vertex].end());
+        transitionCount_[vertex].assign(edges_[vertex].size(), 0);
+      }
+    }
+
+  // The walk stops at the first letter without an edge.
+  template<typename Tword>
+  void record(const Tword& word) {
+    Tvertex vertex = source_;
+    ++visitCount_[vertex];
+    for (Tletter letter: word) {
+      auto finded = std::lower_bound(edges_[vertex].begin(), edges_[vertex].end(), std::make_pair(letter, static_cast<Tvertex>(0)));
+      if (finded == edges_[vertex].end() || finded->first != letter) {
+        return;
+      }
+      ++transitionCount_[vertex][finded - edges_[vertex].begin()];
+      vertex = finded->second;
+      ++visitCount_[vertex];
+    }
+  }
+
+  size_t getVisitCount(Tvertex vertex) const {
+    return visitCount_[vertex];
+  }
+
+  size_t getTransitionCount(Tvertex vertex, Tletter letter) const {
+    auto finded = std::lower_bound(edges_[vertex].begin(), edges_[vertex].end(), std::make_pair(letter, static_cast<Tvertex>(0)));
+    if (finded == edges_[vertex].end() || finded->first != letter) {
+      return 0;
+    }
+    return transitionCount_[vertex][finded - edges_[vertex].begin()];
+  }
+};
+
+// Renumbers vertices so that vertices passed one after another while matching get close numbers,
+// and rows of a transition table (finiteAutomaton_table) built from the answer share cache lines.
+// order_[newVertex] is the old number, newNumber_[oldVertex] is the new one.
+template<typename Tvertex, typename Tletter>
+class finiteAutomaton_relayout {
+public: // Must be private, public only for easy-testing
+  const finiteAutomaton<Tvertex, Tletter>& network_;
+  std::vector<std::vector<std::pair<Tletter, Tvertex>>> edges_;
+  std::vector<Tvertex> order_;
+  std::vector<Tvertex> newNumber_;
+  size_t hotVertexCount_;
+
+  static constexpr Tvertex unplacedVertex = static_cast<Tvertex>(-1);
+
+  void prepareEdges() {
+    for (size_t vertex = 0; vertex < network_.vertexCount(); ++vertex) {
+      for (auto adjacentEdgesIterator = network_.getBegin(vertex); adjacentEdgesIterator.valid(); adjacentEdgesIterator.next()) {
+        edges_[vertex].push_back({adjacentEdgesIterator.getLetter(), adjacentEdgesIterator.getFinish()});
+      }
+      std::sort(edges_[vertex].begin(), edges_[vertex].end());
+    }
+  }
+
+  void placeVertex(Tvertex vertex) {
+    if (newNumber_[vertex] == unplacedVertex) {
+      newNumber_[vertex] = static_cast<Tvertex>(order_.size());
+      order_.push_back(vertex);
+    }
+  }
+
+  // Preorder from start through unplaced allowed vertices, edges of every vertex taken in the order of edges_.
+  template<typename TvertexFilter>
+  void placeDfs(Tvertex start, TvertexFilter&& isAllowed) {
+    if (newNumber_[start] != unplacedVertex || !isAllowed(start)) {
+      return;
+    }
+    std::vector<std::pair<Tvertex, size_t>> verticesStack = {{start, 0}};
+    placeVertex(start);
+    while (!verticesStack.empty()) {
+      auto& [vertex, position] = verticesStack.back();
+      if (position == edges_[vertex].size()) {
+        verticesStack.pop_back();
+        continue;
+      }
+      Tvertex adjacentVertex = edges_[vertex][position++].second;
+      if (newNumber_[adjacentVertex] == unplacedVertex && isAllowed(adjacentVertex)) {
+        placeVertex(adjacentVertex);
+        verticesStack.push_back({adjacentVertex, 0});
+      }
+    }
+  }
+
+  // Passes through already placed vertices too, so vertices behind them are still placed in BFS order.
+  void placeBfs() {
+    std::vector<bool> isVertexUsed(network_.vertexCount(), false);
+    std::queue<Tvertex> verticesQueue;
+    verticesQueue.push(network_.getSource());
+    isVertexUsed[network_.getSource()] = true;
+    while (!verticesQueue.empty()) {
+      Tvertex vertex = verticesQueue.front();
+      verticesQueue.pop();
+      placeVertex(vertex);
+      for (const auto& edge: edges_[vertex]) {
+        if (!isVertexUsed[edge.second]) {
+          isVertexUsed[edge.second] = true;
+          verticesQueue.push(edge.second);
+        }
+      }
+    }
+  }
+
+  void placeUnreachable() {
+    for (size_t vertex = 0; vertex < network_.vertexCount(); ++vertex) {
+      placeVertex(static_cast<Tvertex>(vertex));
+    }
+  }
+
+public:
+  explicit finiteAutomaton_relayout(const finiteAutomaton<Tvertex, Tletter>& networkReference,
+                                    finiteAutomaton_layoutOrder layoutOrder = finiteAutomaton_layoutOrder::bfs):
+    network_(networkReference),
+    edges_(networkReference.vertexCount()),
+    newNumber_(networkReference.vertexCount(), unplacedVertex),
+    hotVertexCount_(0) {
+      prepareEdges();
+      if (layoutOrder == finiteAutomaton_layoutOrder::dfs) {
+        placeDfs(network_.getSource(), [](Tvertex) { return true; });
+      } else {
+        placeBfs();
+      }
+      placeUnreachable();
+    }
+
+  // Vertices visited more than coldThreshold times come first, each time following the most frequent edge,
+  // so a hot path lies in consecutive rows. The walks start from the source and then from every hot vertex
+  // left, the most visited first, so hot vertices entered only through cold ones are hot too.
+  // The rest form the cold region after them, in BFS order.
+  explicit finiteAutomaton_relayout(const finiteAutomaton<Tvertex, Tletter>& networkReference,
+                                    const finiteAutomaton_profile<Tvertex, Tletter>& profile, size_t coldThreshold = 0):
+    network_(networkReference),
+    edges_(networkReference.vertexCount()),
+    newNumber_(networkReference.vertexCount(), unplacedVertex),
+    hotVertexCount_(0) {
+      assert(profile.visitCount_.size() == network_.vertexCount());
+      prepareEdges();
+      for (size_t vertex = 0; vertex < network_.vertexCount(); ++vertex) {
+        std::stable_sort(edges_[vertex].begin(), edges_[vertex].end(), [&](const auto& firstEdge, const auto& secondEdge) {
+          return profile.getTransitionCount(vertex, firstEdge.first) > profile.getTransitionCount(vertex, secondEdge.first);
+        });
+      }
+      auto isHot = [&](Tvertex vertex) { return profile.getVisitCount(vertex) > coldThreshold; };
+      placeDfs(network_.getSource(), isHot);
+      std::vector<Tvertex> hotVertices;
+      for (size_t vertex = 0; vertex < network_.vertexCount(); ++vertex) {
+        if (isHot(static_cast<Tvertex>(vertex))) {
+          hotVertices.push_back(static_cast<Tvertex>(vertex));
+        }
+      }
+      std::stable_sort(hotVertices.begin(), hotVertices.end(), [&](Tvertex firstVertex, Tvertex secondVertex) {
+        return profile.getVisitCount(firstVertex) > profile.getVisitCount(secondVertex);
+      });
+      for (auto vertex: hotVertices) {
+        placeDfs(vertex, isHot);
+      }
+      hotVertexCount_ = order_.size();
+      placeBfs();
+      placeUnreachable();
+    }
+
+  // Vertices [0, getHotVertexCount()) of the answer are the hot region.
+  size_t getHotVertexCount() const {
+    return hotVertexCount_;
+  }
+
+  Tvertex getNewNumber(Tvertex vertex) const {
+    return newNumber_[vertex];
+  }
+
+  // Edges of every vertex keep their order in the input.
+  finiteAutomaton<Tvertex, Tletter> execute() {
+    finiteAutomaton<Tvertex, Tletter> answer(order_.size(), newNumber_[network_.getSource()], std::vector<bool>(order_.size(), false));
+    for (size_t vertex = 0; vertex < order_.size(); ++vertex) {
+      answer.isTerminal_[vertex] = network_.isTerminal_[order_[vertex]];
+      for (auto adjacentEdgesIterator = network_.getBegin(order_[vertex]); adjacentEdgesIterator.valid(); adjacentEdgesIterator.next()) {
+        answer.insertEdge(static_cast<Tvertex>(vertex), newNumber_[adjacentEdgesIterator.getFinish()], adjacentEdgesIterator.getLetter());
+      }
+    }
+    return answer;
+  }
+};
@@ -0,0 +1,114 @@
+#pragma once
+#include "finiteAutomaton.cpp"
+
+// One DFA for many patterns. Every vertex refers to a set of pattern ids (patternSets_[patternSet_[vertex]]),
+// the sets are stored once each. They are built in the subset construction and minimization never merges
+// vertices with different sets, so one pass over a word reports every pattern accepting it.
+template<typename Tvertex, typename Tletter>
+class finiteAutomaton_multiPattern {
+public: // Must be private, public only for easy-testing
+  finiteAutomaton<Tvertex, Tletter> automaton_;
+  std::vector<std::vector<int>> patternSets_;
+  std::vector<int> patternSet_;
+  std::vector<std::vector<std::pair<Tletter, Tvertex>>> edges_;
+  std::vector<int> emptyPatternSet_;
+
+  int getPatternSetIndex(std::vector<int> patternSet, std::map<std::vector<int>, int>& patternSetIndex) {
+    sort(patternSet.begin(), patternSet.end());
+    patternSet.erase(std::unique(patternSet.begin(), patternSet.end()), patternSet.end());
+    auto finded = patternSetIndex.find(patternSet);
+    if (finded != patternSetIndex.end()) {
+      return finded->second;
+    }
+    int index = static_cast<int>(patternSets_.size());
+    patternSetIndex.emplace(patternSet, index);
+    patternSets_.push_back(std::move(patternSet));
+    return index;
+  }
+
+public:
+  // Pattern ids are positions in patterns. Every pattern may contain zeroLetter edges.
+  explicit finiteAutomaton_multiPattern(std::vector<finiteAutomaton<Tvertex, Tletter>> patterns,
+                                        Tletter zeroLetter = defaultZeroLetter<Tletter>()):
+    automaton_(1, 0, std::vector<Tvertex>()) {
+      size_t vertexCount = 1;
+      for (auto& pattern: patterns) {
+        pattern = std::move(pattern).eraseZeroEdges(zeroLetter);
+        vertexCount += pattern.vertexCount();
+      }
+      Tvertex unitedSource = static_cast<Tvertex>(0);
+      finiteAutomaton<Tvertex, Tletter> united(vertexCount, unitedSource, std::vector<Tvertex>());
+      std::vector<int> vertexPattern(vertexCount, -1);
+      std::vector<int> sourcePatterns;
+      Tvertex shift = static_cast<Tvertex>(1);
+      for (size_t patternNumber = 0; patternNumber < patterns.size(); ++patternNumber) {
+        auto& pattern = patterns[patternNumber];
+        for (auto edge: pattern.getEdges()) {
+          united.insertEdge(edge.start + shift, edge.finish + shift, edge.letter);
+          if (edge.start == pattern.getSource()) {
+            united.insertEdge(unitedSource, edge.finish + shift, edge.letter);
+          }
+        }
+        for (auto terminalVertex: pattern.getTerminals()) {
+          united.isTerminal_[terminalVertex + shift] = true;
+          vertexPattern[terminalVertex + shift] = static_cast<int>(patternNumber);
+          if (terminalVertex == pattern.getSource()) {
+            sourcePatterns.push_back(static_cast<int>(patternNumber));
+          }
+        }
+        shift += static_cast<Tvertex>(pattern.vertexCount());
+      }
+      united.isTerminal_[unitedSource] = !sourcePatterns.empty();
+      finiteAutomaton_determinator<Tvertex, Tletter> determinator(united);
+      finiteAutomaton<Tvertex, Tletter> deterministic = determinator.execute();
+      // Sets are numbered densely in the order they occur: an unused number would become an isolated class of the minimizer.
+      std::map<std::vector<int>, int> patternSetIndex;
+      std::vector<int> deterministicPatternSet(deterministic.vertexCount(), 0);
+      for (size_t vertex = 0; vertex < determinator.arrayOfSubsets.size(); ++vertex) {
+        std::vector<int> patternSet;
+        for (auto unitedVertex: determinator.arrayOfSubsets[vertex]) {
+          if (unitedVertex == unitedSource) {
+            patternSet.insert(patternSet.end(), sourcePatterns.begin(), sourcePatterns.end());
+          } else if (vertexPattern[unitedVertex] != -1) {
+            patternSet.push_back(vertexPattern[unitedVertex]);
+          }
+        }
+        deterministicPatternSet[vertex] = getPatternSetIndex(std::move(patternSet), patternSetIndex);
+      }
+      finiteAutomaton_minimizer<Tvertex, Tletter> minimizer(deterministic, deterministicPatternSet);
+      automaton_ = minimizer.execute();
+      patternSet_.assign(automaton_.vertexCount(), 0);
+      for (size_t vertex = 0; vertex < deterministic.vertexCount(); ++vertex) {
+        patternSet_[minimizer.classNumber_[vertex]] = deterministicPatternSet[vertex];
+      }
+      edges_.resize(automaton_.vertexCount());
+      for (size_t vertex = 0; vertex < automaton_.vertexCount(); ++vertex) {
+        for (auto adjacentEdgesIterator = automaton_.getBegin(vertex); adjacentEdgesIterator.valid(); adjacentEdgesIterator.next()) {
+          edges_[vertex].push_back({adjacentEdgesIterator.getLetter(), adjacentEdgesIterator.getFinish()});
+        }
+        sort(edges_[vertex].begin(), edges_[vertex].end());
+      }
+    }
+
+  const finiteAutomaton<Tvertex, Tletter>& getAutomaton() const {
+    return automaton_;
+  }
+
+  const std::vector<int>& getPatterns(Tvertex vertex) const {
+    return patternSets_[patternSet_[vertex]];
+  }
+
+  // Ids of all patterns accepting word, in increasing order.
+  template<typename Tword>
+  const std::vector<int>& match(const Tword& word) const {
+    Tvertex vertex = automaton_.getSource();
+    for (Tletter letter: word) {
+      auto finded = std::lower_bound(edges_[vertex].begin(), edges_[vertex].end(), std::make_pair(letter, static_cast<Tvertex>(0)));
+      if (finded == edges_[vertex].end() || finded->first != letter) {
+        return emptyPatternSet_;
+      }
+      vertex = finded->second;
+    }
+    return getPatterns(vertex);
+  }
+};
@@ -0,0 +1,141 @@
+#pragma once
+#include "finiteAutomatonTable.cpp"
+#include <thread>
+
+template<typename Tvertex, typename Tletter>
+class finiteAutomaton_parallelScanner {
+public:
+  using tableAutomaton = finiteAutomaton_table<Tvertex, Tletter>;
+  using TstateMapping = std::vector<Tvertex>;
+
+  static const size_t defaultMinimalChunkSize = static_cast<size_t>(1) << 16;
+  static const size_t mergePeriod = 64;
+
+public: // Must be private, public only for easy-testing
+  tableAutomaton table_;
+
+  // Runs the chunk from every vertex at once. Runs that meet in one vertex stay merged forever,
+  // so only the distinct current vertices are stepped; on a minimized DFA they collapse quickly.
+  TstateMapping getChunkMapping(const Tletter* data, size_t length) const {
+    size_t vertexCount = table_.vertexCount();
+    std::vector<Tvertex> activeVertices(vertexCount);
+    std::vector<size_t> activeIndex(vertexCount);
+    for (size_t vertex = 0; vertex < vertexCount; ++vertex) {
+      activeVertices[vertex] = static_cast<Tvertex>(vertex);
+      activeIndex[vertex] = vertex;
+    }
+    std::vector<size_t> mergedIndex(vertexCount, vertexCount);
+    std::vector<Tvertex> mergedVertices;
+    std::vector<size_t> oldToMerged(vertexCount);
+    for (size_t position = 0; position < length; ++position) {
+      for (auto& vertex: activeVertices) {
+        vertex = table_.step(vertex, data[position]);
+      }
+      if ((position + 1) % mergePeriod != 0 || activeVertices.size() == 1) {
+        continue;
+      }
+      mergedVertices.clear();
+      for (size_t index = 0; index < activeVertices.size(); ++index) {
+        Tvertex vertex = activeVertices[index];
+        if (mergedIndex[vertex] == vertexCount) {
+          mergedIndex[vertex] = mergedVertices.size();
+          mergedVertices.push_back(vertex);
+        }
+        oldToMerged[index] = mergedIndex[vertex];
+      }
+      for (auto vertex: mergedVertices) {
+        mergedIndex[vertex] = vertexCount;
+      }
+      for (auto& index: activeIndex) {
+        index = oldToMerged[index];
+      }
+      activeVertices.swap(mergedVertices);
+    }
+    TstateMapping answer(vertexCount);
+    for (size_t vertex = 0; vertex < vertexCount; ++vertex) {
+      answer[vertex] = activeVertices[activeIndex[vertex]];
+    }
+    return answer;
+  }
+
+  Tvertex runChunk(Tvertex vertex, const Tletter* data, size_t length) const {
+    for (size_t position = 0; position < length; ++position) {
+      vertex = table_.step(vertex, data[position]);
+    }
+    return vertex;
+  }
+
+public:
+  // The automaton has to be deterministic, e.g. the result of minimize(); missing edges lead to a dead vertex.
+  explicit finiteAutomaton_parallelScanner(const finiteAutomaton<Tvertex, Tletter>& automaton):
+    table_(automaton, true) {}
+
+  // Mappings compose associatively: (second o first)[vertex] = second[first[vertex]].
+  static TstateMapping composeMappings(const TstateMapping& first, const TstateMapping& second) {
+    TstateMapping answer(first.size());
+    for (size_t vertex = 0; vertex < first.size(); ++vertex) {
+      answer[vertex] = second[first[vertex]];
+    }
+    return answer;
+  }
+
+  // Inclusive prefix compositions, mappings[chunk] becomes mappings[chunk] o ... o mappings[0].
+  // Hillis-Steele scan: log(count) rounds, the compositions of one round run in parallel.
+  static void composePrefixes(std::vector<TstateMapping>& mappings) {
+    std::vector<TstateMapping> previousRound;
+    for (size_t offset = 1; offset < mappings.size(); offset *= 2) {
+      previousRound = mappings;
+      std::vector<std::thread> workers;
+      for (size_t chunk = offset; chunk < mappings.size(); ++chunk) {
+        workers.emplace_back([&mappings, &previousRound, chunk, offset]() {
+          mappings[chunk] = composeMappings(previousRound[chunk - offset], previousRound[chunk]);
+        });
+      }
+      for (auto& worker: workers) {
+        worker.join();
+      }
+    }
+  }
+
+  // Returns the exact vertex at every chunk boundary, the last one is the vertex after the whole input.
+  // The first chunk is run from the source only, every other chunk speculatively from every vertex,
+  // then every boundary is read from a prefix composition of the chunk mappings.
+  std::vector<Tvertex> getBoundaryVertices(const Tletter* data, size_t length, size_t threadCount = std::thread::hardware_concurrency(),
+                                           size_t minimalChunkSize = defaultMinimalChunkSize) const {
+    threadCount = std::max<size_t>(1, std::min(threadCount, length / std::max<size_t>(1, minimalChunkSize)));
+    size_t chunkSize = (length + threadCount - 1) / std::max<size_t>(1, threadCount);
+    std::vector<Tvertex> boundaryVertices(threadCount + 1, table_.source);
+    if (threadCount == 1) {
+      boundaryVertices[1] = runChunk(table_.source, data, length);
+      return boundaryVertices;
+    }
+    std::vector<TstateMapping> chunkMappings(threadCount - 1);
+    std::vector<std::thread> workers;
+    for (size_t chunk = 1; chunk < threadCount; ++chunk) {
+      size_t chunkStart = std::min(length, chunk * chunkSize);
+      size_t chunkLength = std::min(chunkSize, length - chunkStart);
+      workers.emplace_back([this, &chunkMappings, chunk, data, chunkStart, chunkLength]() {
+        chunkMappings[chunk - 1] = getChunkMapping(data + chunkStart, chunkLength);
+      });
+    }
+    boundaryVertices[1] = runChunk(table_.source, data, std::min(chunkSize, length));
+    for (auto& worker: workers) {
+      worker.join();
+    }
+    composePrefixes(chunkMappings);
+    for (size_t chunk = 1; chunk < threadCount; ++chunk) {
+      boundaryVertices[chunk + 1] = chunkMappings[chunk - 1][boundaryVertices[1]];
+    }
+    return boundaryVertices;
+  }
+
+  Tvertex getFinalVertex(const Tletter* data, size_t length, size_t threadCount = std::thread::hardware_concurrency(),
+                         size_t minimalChunkSize = defaultMinimalChunkSize) const {
+    return getBoundaryVertices(data, length, threadCount, minimalChunkSize).back();
+  }
+
+  bool accepts(const Tletter* data, size_t length, size_t threadCount = std::thread::hardware_concurrency(),
+               size_t minimalChunkSize = defaultMinimalChunkSize) const {
+    return table_.isTerminal[getFinalVertex(data, length, threadCount, minimalChunkSize)];
+  }
+};
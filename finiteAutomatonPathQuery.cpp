@@ -0,0 +1,302 @@
+#pragma once
+#include "finiteAutomaton.cpp"
+#include <limits>
+#include <set>
+
+// Semirings for finiteAutomaton_pathQuery. plus must pick one of its arguments (max, min), zero is
+// "no path", one is the empty path, infinity is what an improving cycle drives a value to.
+template<typename TweightType>
+class maxPlusSemiring {
+public:
+  using Tweight = TweightType;
+
+  static Tweight zero() {
+    return std::numeric_limits<Tweight>::lowest();
+  }
+
+  static Tweight one() {
+    return static_cast<Tweight>(0);
+  }
+
+  static Tweight infinity() {
+    return std::numeric_limits<Tweight>::max();
+  }
+
+  static Tweight plus(Tweight firstWeight, Tweight secondWeight) {
+    return std::max(firstWeight, secondWeight);
+  }
+
+  static Tweight times(Tweight firstWeight, Tweight secondWeight) {
+    if (firstWeight == zero() || secondWeight == zero()) {
+      return zero();
+    }
+    if (firstWeight == infinity() || secondWeight == infinity()) {
+      return infinity();
+    }
+    return firstWeight + secondWeight;
+  }
+};
+
+template<typename TweightType>
+class minPlusSemiring {
+public:
+  using Tweight = TweightType;
+
+  static Tweight zero() {
+    return std::numeric_limits<Tweight>::max();
+  }
+
+  static Tweight one() {
+    return static_cast<Tweight>(0);
+  }
+
+  static Tweight infinity() {
+    return std::numeric_limits<Tweight>::lowest();
+  }
+
+  static Tweight plus(Tweight firstWeight, Tweight secondWeight) {
+    return std::min(firstWeight, secondWeight);
+  }
+
+  static Tweight times(Tweight firstWeight, Tweight secondWeight) {
+    if (firstWeight == zero() || secondWeight == zero()) {
+      return zero();
+    }
+    if (firstWeight == infinity() || secondWeight == infinity()) {
+      return infinity();
+    }
+    return firstWeight + secondWeight;
+  }
+};
+
+// value(v) = plus over all paths from v to a terminal of the times-product of edge weights.
+// Only useful vertices (reachable from the source and co-reachable to a terminal) are evaluated.
+// Strongly connected components are processed in reverse topological order: edges leaving a component
+// are taken once, inside a component Bellman-Ford runs for its size; a component that still improves
+// after that has an improving cycle, and every vertex of it gets infinity.
+template<typename Tvertex, typename Tletter, typename Tsemiring>
+class finiteAutomaton_pathQuery {
+public:
+  using Tweight = typename Tsemiring::Tweight;
+  using Edge = typename finiteAutomaton<Tvertex, Tletter>::Edge;
+
+public: // Must be private, public only for easy-testing
+  std::vector<std::vector<std::pair<Tvertex, Tweight>>> edges_;
+  std::vector<bool> isTerminal_;
+  std::vector<bool> isUseful_;
+  std::vector<int> component_;
+  std::vector<std::vector<Tvertex>> components_;
+  std::vector<Tweight> value_;
+  Tvertex source_;
+
+  static std::vector<bool> getReachable(const std::vector<std::vector<Tvertex>>& graph, const std::vector<Tvertex>& starts) {
+    std::vector<bool> isReachable(graph.size(), false);
+    std::vector<Tvertex> verticesStack;
+    for (auto vertex: starts) {
+      if (!isReachable[vertex]) {
+        isReachable[vertex] = true;
+        verticesStack.push_back(vertex);
+      }
+    }
+    while (!verticesStack.empty()) {
+      Tvertex vertex = verticesStack.back();
+      verticesStack.pop_back();
+      for (auto adjacentVertex: graph[vertex]) {
+        if (!isReachable[adjacentVertex]) {
+          isReachable[adjacentVertex] = true;
+          verticesStack.push_back(adjacentVertex);
+        }
+      }
+    }
+    return isReachable;
+  }
+
+  // Kosaraju: components_ come out in topological order of the condensation.
+  void findComponents(const std::vector<std::vector<Tvertex>>& reversedGraph) {
+    size_t vertexCount = edges_.size();
+    std::vector<Tvertex> order;
+    std::vector<bool> isVertexUsed(vertexCount, false);
+    std::vector<std::pair<Tvertex, size_t>> verticesStack;
+    for (size_t startVertex = 0; startVertex < vertexCount; ++startVertex) {
+      if (!isUseful_[startVertex] || isVertexUsed[startVertex]) {
+        continue;
+      }
+      isVertexUsed[startVertex] = true;
+      verticesStack.push_back({static_cast<Tvertex>(startVertex), 0});
+      while (!verticesStack.empty()) {
+        Tvertex vertex = verticesStack.back().first;
+        size_t& position = verticesStack.back().second;
+        if (position == edges_[vertex].size()) {
+          order.push_back(vertex);
+          verticesStack.pop_back();
+          continue;
+        }
+        Tvertex adjacentVertex = edges_[vertex][position++].first;
+        if (isUseful_[adjacentVertex] && !isVertexUsed[adjacentVertex]) {
+          isVertexUsed[adjacentVertex] = true;
+          verticesStack.push_back({adjacentVertex, 0});
+        }
+      }
+    }
+    component_.assign(vertexCount, -1);
+    for (size_t position = order.size(); position-- > 0;) {
+      Tvertex startVertex = order[position];
+      if (component_[startVertex] != -1) {
+        continue;
+      }
+      int componentNumber = static_cast<int>(components_.size());
+      components_.push_back({startVertex});
+      component_[startVertex] = componentNumber;
+      for (size_t index = 0; index < components_.back().size(); ++index) {
+        for (auto adjacentVertex: reversedGraph[components_.back()[index]]) {
+          if (isUseful_[adjacentVertex] && component_[adjacentVertex] == -1) {
+            component_[adjacentVertex] = componentNumber;
+            components_.back().push_back(adjacentVertex);
+          }
+        }
+      }
+    }
+  }
+
+  bool relaxComponent(const std::vector<Tvertex>& component, int componentNumber) {
+    bool isChanged = false;
+    for (auto vertex: component) {
+      for (const auto& edge: edges_[vertex]) {
+        if (component_[edge.first] != componentNumber) {
+          continue;
+        }
+        Tweight candidate = Tsemiring::plus(value_[vertex], Tsemiring::times(edge.second, value_[edge.first]));
+        if (candidate != value_[vertex]) {
+          value_[vertex] = candidate;
+          isChanged = true;
+        }
+      }
+    }
+    return isChanged;
+  }
+
+  void evaluate() {
+    value_.assign(edges_.size(), Tsemiring::zero());
+    for (size_t componentNumber = components_.size(); componentNumber-- > 0;) {
+      const auto& component = components_[componentNumber];
+      for (auto vertex: component) {
+        value_[vertex] = isTerminal_[vertex] ? Tsemiring::one() : Tsemiring::zero();
+        for (const auto& edge: edges_[vertex]) {
+          if (isUseful_[edge.first] && component_[edge.first] != static_cast<int>(componentNumber)) {
+            value_[vertex] = Tsemiring::plus(value_[vertex], Tsemiring::times(edge.second, value_[edge.first]));
+          }
+        }
+      }
+      bool isChanged = true;
+      for (size_t iteration = 0; iteration < component.size() && isChanged; ++iteration) {
+        isChanged = relaxComponent(component, static_cast<int>(componentNumber));
+      }
+      if (isChanged && relaxComponent(component, static_cast<int>(componentNumber))) {
+        for (auto vertex: component) {
+          value_[vertex] = Tsemiring::infinity();
+        }
+      }
+    }
+  }
+
+public:
+  // edgeWeight is called once for every edge of the automaton.
+  template<typename TedgeWeight>
+  explicit finiteAutomaton_pathQuery(const finiteAutomaton<Tvertex, Tletter>& automaton, TedgeWeight&& edgeWeight):
+    edges_(automaton.vertexCount()),
+    isTerminal_(automaton.isTerminal_),
+    source_(automaton.getSource()) {
+      std::vector<std::vector<Tvertex>> graph(automaton.vertexCount());
+      std::vector<std::vector<Tvertex>> reversedGraph(automaton.vertexCount());
+      for (size_t vertex = 0; vertex < automaton.vertexCount(); ++vertex) {
+        for (auto adjacentEdgesIterator = automaton.getBegin(vertex); adjacentEdgesIterator.valid(); adjacentEdgesIterator.next()) {
+          edges_[vertex].push_back({adjacentEdgesIterator.getFinish(), edgeWeight(adjacentEdgesIterator.getEdge())});
+          graph[vertex].push_back(adjacentEdgesIterator.getFinish());
+          reversedGraph[adjacentEdgesIterator.getFinish()].push_back(static_cast<Tvertex>(vertex));
+        }
+      }
+      isUseful_ = getReachable(graph, {source_});
+      std::vector<bool> isCoreachable = getReachable(reversedGraph, automaton.getTerminals());
+      for (size_t vertex = 0; vertex < isUseful_.size(); ++vertex) {
+        isUseful_[vertex] = isUseful_[vertex] && isCoreachable[vertex];
+      }
+      findComponents(reversedGraph);
+      evaluate();
+    }
+
+  bool isUseful(Tvertex vertex) const {
+    return isUseful_[vertex];
+  }
+
+  // Tsemiring::zero() for useless vertices.
+  Tweight getValue(Tvertex vertex) const {
+    return value_[vertex];
+  }
+
+  Tweight execute() const {
+    return value_[source_];
+  }
+};
+
+// Vertex v is copied into three layers: v (before the run), v + n (inside the run) and v + 2n (after it).
+// Layers are joined by zeroLetter edges, the middle layer only keeps edges over runLetters.
+template<typename Tvertex, typename Tletter>
+finiteAutomaton<Tvertex, Tletter> getLetterRunAutomaton(const finiteAutomaton<Tvertex, Tletter>& base, const std::vector<Tletter>& runLetters,
+                                                        Tletter zeroLetter = defaultZeroLetter<Tletter>()) {
+  Tvertex shift = static_cast<Tvertex>(base.vertexCount());
+  std::vector<Tvertex> answerTerminals;
+  for (auto vertex: base.getTerminals()) {
+    answerTerminals.push_back(vertex + 2 * shift);
+  }
+  finiteAutomaton<Tvertex, Tletter> answer(3 * base.vertexCount(), base.getSource(), answerTerminals);
+  std::set<Tletter> isRunLetter(runLetters.begin(), runLetters.end());
+  for (Tvertex vertex = 0; vertex < shift; ++vertex) {
+    answer.insertEdge(vertex, vertex + shift, zeroLetter);
+    answer.insertEdge(vertex + shift, vertex + 2 * shift, zeroLetter);
+  }
+  for (auto edge: base.getEdges()) {
+    answer.insertEdge(edge.start, edge.finish, edge.letter);
+    answer.insertEdge(edge.start + 2 * shift, edge.finish + 2 * shift, edge.letter);
+    if (isRunLetter.count(edge.letter)) {
+      answer.insertEdge(edge.start + shift, edge.finish + shift, edge.letter);
+    }
+  }
+  return answer;
+}
+
+template<typename Tvertex, typename Tletter>
+long long getShortestWordLength(const finiteAutomaton<Tvertex, Tletter>& automaton, Tletter zeroLetter = defaultZeroLetter<Tletter>()) {
+  finiteAutomaton_pathQuery<Tvertex, Tletter, minPlusSemiring<long long>> query(automaton, [&](const auto& edge) {
+    return (edge.letter == zeroLetter) ? 0LL : 1LL;
+  });
+  return query.execute();
+}
+
+template<typename Tvertex, typename Tletter>
+long long getLongestWordLength(const finiteAutomaton<Tvertex, Tletter>& automaton, Tletter zeroLetter = defaultZeroLetter<Tletter>()) {
+  finiteAutomaton_pathQuery<Tvertex, Tletter, maxPlusSemiring<long long>> query(automaton, [&](const auto& edge) {
+    return (edge.letter == zeroLetter) ? 0LL : 1LL;
+  });
+  return query.execute();
+}
+
+template<typename Tvertex, typename Tletter>
+long long getLongestLetterRun(const finiteAutomaton<Tvertex, Tletter>& automaton, const std::vector<Tletter>& runLetters,
+                              Tletter zeroLetter = defaultZeroLetter<Tletter>()) {
+  auto layered = getLetterRunAutomaton(automaton, runLetters, zeroLetter);
+  Tvertex shift = static_cast<Tvertex>(automaton.vertexCount());
+  finiteAutomaton_pathQuery<Tvertex, Tletter, maxPlusSemiring<long long>> query(layered, [&](const auto& edge) {
+    bool isInsideRun = (edge.letter != zeroLetter) && (edge.start >= shift) && (edge.start < 2 * shift);
+    return isInsideRun ? 1LL : 0LL;
+  });
+  return query.execute();
+}
+
+template<typename Tvertex, typename Tletter>
+long long getMinimalWordCost(const finiteAutomaton<Tvertex, Tletter>& automaton, const std::map<Tletter, long long>& letterCost,
+                             Tletter zeroLetter = defaultZeroLetter<Tletter>()) {
+  finiteAutomaton_pathQuery<Tvertex, Tletter, minPlusSemiring<long long>> query(automaton, [&](const auto& edge) {
+    return (edge.letter == zeroLetter) ? 0LL : letterCost.at(edge.letter);
+  });
+  return query.execute();
+}
@@ -0,0 +1,164 @@
+#pragma once
+#include "finiteAutomatonArithmetic.cpp"
+#include "finiteAutomatonTable.cpp"
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+template<typename Tvertex, typename Tletter>
+class finiteAutomaton_searcher {
+public:
+  using tableAutomaton = finiteAutomaton_table<Tvertex, Tletter>;
+
+  static const size_t tableWidth = tableAutomaton::tableWidth;
+  static const size_t defaultChunkSize = static_cast<size_t>(1) << 24;
+
+  class scanState {
+  public:
+    Tvertex vertex;
+    size_t offset;
+
+    explicit scanState(Tvertex startVertex):
+      vertex(startVertex),
+      offset(0) {}
+  };
+
+public: // Must be private, public only for easy-testing
+  tableAutomaton forward_;
+  tableAutomaton backward_;
+
+  // Sigma* L: a loop on the source over every letter of the pattern. A path that last uses the loop at
+  // some position reads a word of L from there on, so no fresh source vertex is needed.
+  static finiteAutomaton<Tvertex, Tletter> getUnanchoredAutomaton(finiteAutomaton<Tvertex, Tletter> pattern,
+                                                                  const std::vector<Tletter>& alphabetLetters) {
+    for (Tletter letter: alphabetLetters) {
+      pattern.insertEdge(pattern.getSource(), pattern.getSource(), letter);
+    }
+    return pattern;
+  }
+
+  static std::vector<Tletter> getUsedLetters(const finiteAutomaton<Tvertex, Tletter>& automaton) {
+    std::vector<Tletter> alphabetLetters;
+    for (auto edge: automaton.getEdges()) {
+      alphabetLetters.push_back(edge.letter);
+    }
+    sort(alphabetLetters.begin(), alphabetLetters.end());
+    alphabetLetters.erase(std::unique(alphabetLetters.begin(), alphabetLetters.end()), alphabetLetters.end());
+    return alphabetLetters;
+  }
+
+  // Walks back until the reversed DFA dies, so it costs the length of the longest match ending at matchEnd.
+  // For a pattern like a(a+b)*b that is up to matchEnd itself.
+  size_t findStart(const Tletter* data, size_t matchEnd) const {
+    size_t matchStart = matchEnd;
+    Tvertex vertex = backward_.source;
+    for (size_t position = matchEnd; position > 0 && !backward_.isDead[vertex]; --position) {
+      vertex = backward_.step(vertex, data[position - 1]);
+      if (backward_.isTerminal[vertex]) {
+        matchStart = position - 1;
+      }
+    }
+    return matchStart;
+  }
+
+public:
+  explicit finiteAutomaton_searcher(finiteAutomaton<Tvertex, Tletter> pattern, Tletter zeroLetter = defaultZeroLetter<Tletter>()) {
+      pattern = std::move(pattern).eraseZeroEdges(zeroLetter);
+      std::vector<Tletter> alphabetLetters = getUsedLetters(pattern);
+      auto forwardAutomaton = getUnanchoredAutomaton(pattern, alphabetLetters).compile(zeroLetter, alphabetLetters);
+      forward_ = tableAutomaton(forwardAutomaton, false);
+      auto backwardAutomaton = reversal<Tvertex, Tletter>(std::move(pattern), zeroLetter).compile(zeroLetter, alphabetLetters);
+      backward_ = tableAutomaton(backwardAutomaton, true);
+    }
+
+  // Emits the empty match at offset 0, if the pattern accepts the empty word.
+  template<typename TmatchCallback>
+  scanState startScan(TmatchCallback&& onMatchEnd) const {
+    scanState state(forward_.source);
+    if (forward_.isTerminal[state.vertex]) {
+      onMatchEnd(static_cast<size_t>(0));
+    }
+    return state;
+  }
+
+  // Feeds the next piece of a stream, match ends are reported as offsets from the start of the stream.
+  template<typename TmatchCallback>
+  void feed(scanState& state, const Tletter* data, size_t length, TmatchCallback&& onMatchEnd) const {
+    Tvertex vertex = state.vertex;
+    const Tvertex* transitions = forward_.transitions.data();
+    const char* isTerminal = forward_.isTerminal.data();
+    for (size_t position = 0; position < length; ++position) {
+      vertex = transitions[static_cast<size_t>(vertex) * tableWidth + static_cast<unsigned char>(data[position])];
+      if (isTerminal[vertex]) {
+        onMatchEnd(state.offset + position + 1);
+      }
+    }
+    state.vertex = vertex;
+    state.offset += length;
+  }
+
+  template<typename TmatchCallback>
+  void findMatchEnds(const Tletter* data, size_t length, TmatchCallback&& onMatchEnd, size_t chunkSize = defaultChunkSize) const {
+    assert(chunkSize > 0);
+    scanState state = startScan(onMatchEnd);
+    for (size_t chunkStart = 0; chunkStart < length; chunkStart += chunkSize) {
+      feed(state, data + chunkStart, std::min(chunkSize, length - chunkStart), onMatchEnd);
+    }
+  }
+
+  // For every match end reports the leftmost start of a match ending there, found by the reversed automaton.
+  // Every start is searched separately, so the time is O(length + sum of the longest match lengths over match ends):
+  // linear for matches of bounded length, but up to quadratic when long matches end almost everywhere.
+  template<typename TmatchCallback>
+  void findMatches(const Tletter* data, size_t length, TmatchCallback&& onMatch, size_t chunkSize = defaultChunkSize) const {
+    findMatchEnds(data, length, [&](size_t matchEnd) {
+      onMatch(findStart(data, matchEnd), matchEnd);
+    }, chunkSize);
+  }
+
+  // Maps the whole file read-only and scans it chunk by chunk, returns false if the file can not be mapped.
+  template<typename TmatchCallback>
+  bool findMatchEndsInFile(const std::string& path, TmatchCallback&& onMatchEnd, size_t chunkSize = defaultChunkSize) const {
+    return scanFile(path, [&](const Tletter* data, size_t length) {
+      findMatchEnds(data, length, onMatchEnd, chunkSize);
+    });
+  }
+
+  template<typename TmatchCallback>
+  bool findMatchesInFile(const std::string& path, TmatchCallback&& onMatch, size_t chunkSize = defaultChunkSize) const {
+    return scanFile(path, [&](const Tletter* data, size_t length) {
+      findMatches(data, length, onMatch, chunkSize);
+    });
+  }
+
+private:
+  template<typename TscanCallback>
+  static bool scanFile(const std::string& path, TscanCallback&& onMapped) {
+    int fileDescriptor = open(path.c_str(), O_RDONLY);
+    if (fileDescriptor < 0) {
+      return false;
+    }
+    struct stat fileStatus;
+    if (fstat(fileDescriptor, &fileStatus) != 0) {
+      close(fileDescriptor);
+      return false;
+    }
+    size_t length = static_cast<size_t>(fileStatus.st_size);
+    if (length == 0) {
+      close(fileDescriptor);
+      onMapped(static_cast<const Tletter*>(nullptr), length);
+      return true;
+    }
+    void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    close(fileDescriptor);
+    if (mapping == MAP_FAILED) {
+      return false;
+    }
+    madvise(mapping, length, MADV_SEQUENTIAL);
+    onMapped(static_cast<const Tletter*>(mapping), length);
+    munmap(mapping, length);
+    return true;
+  }
+};
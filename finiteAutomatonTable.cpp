@@ -0,0 +1,64 @@
+#pragma once
+#include "finiteAutomaton.cpp"
+
+template<typename Tvertex, typename Tletter>
+class finiteAutomaton_table {
+  static_assert(sizeof(Tletter) == 1, "finiteAutomaton_table is indexed by bytes, Tletter must be one byte wide");
+
+public:
+  static const size_t tableWidth = 256;
+
+  std::vector<Tvertex> transitions;
+  std::vector<char> isTerminal;
+  std::vector<char> isDead;
+  Tvertex source;
+
+  finiteAutomaton_table():
+    source(0) {}
+
+  // One extra dead row is always appended. Letters missing from the automaton go to that row,
+  // or back to the source if isMissingLetterDead is false.
+  explicit finiteAutomaton_table(const finiteAutomaton<Tvertex, Tletter>& automaton, bool isMissingLetterDead = true):
+    transitions((automaton.vertexCount() + 1) * tableWidth, 
+                isMissingLetterDead ? static_cast<Tvertex>(automaton.vertexCount()) : automaton.getSource()),
+    isTerminal(automaton.vertexCount() + 1, false),
+    isDead(automaton.vertexCount() + 1, true),
+    source(automaton.getSource()) {
+      Tvertex deadVertex = static_cast<Tvertex>(automaton.vertexCount());
+      std::fill(transitions.begin() + static_cast<size_t>(deadVertex) * tableWidth, transitions.end(), deadVertex);
+      std::vector<std::vector<Tvertex>> reversedEdges(vertexCount());
+      for (size_t vertex = 0; vertex < automaton.vertexCount(); ++vertex) {
+        isTerminal[vertex] = automaton.isTerminal_[vertex];
+        for (auto adjacentEdgesIterator = automaton.getBegin(vertex); adjacentEdgesIterator.valid(); adjacentEdgesIterator.next()) {
+          size_t letterIndex = static_cast<unsigned char>(adjacentEdgesIterator.getLetter());
+          transitions[vertex * tableWidth + letterIndex] = adjacentEdgesIterator.getFinish();
+          reversedEdges[adjacentEdgesIterator.getFinish()].push_back(static_cast<Tvertex>(vertex));
+        }
+      }
+      std::queue<Tvertex> verticesQueue;
+      for (size_t vertex = 0; vertex < vertexCount(); ++vertex) {
+        if (isTerminal[vertex]) {
+          isDead[vertex] = false;
+          verticesQueue.push(static_cast<Tvertex>(vertex));
+        }
+      }
+      while (!verticesQueue.empty()) {
+        Tvertex vertex = verticesQueue.front();
+        verticesQueue.pop();
+        for (auto adjacentVertex: reversedEdges[vertex]) {
+          if (isDead[adjacentVertex]) {
+            isDead[adjacentVertex] = false;
+            verticesQueue.push(adjacentVertex);
+          }
+        }
+      }
+    }
+
+  size_t vertexCount() const {
+    return isTerminal.size();
+  }
+
+  Tvertex step(Tvertex vertex, Tletter letter) const {
+    return transitions[static_cast<size_t>(vertex) * tableWidth + static_cast<unsigned char>(letter)];
+  }
+};
@@ -0,0 +1,255 @@
+#pragma once
+#include "finiteAutomaton.cpp"
+#include <cstdint>
+#include <random>
+#include <type_traits>
+
+// Arbitrary-precision non-negative integer, enough for counting, unranking and sampling.
+class bigCount {
+public: // Must be private, public only for easy-testing
+  std::vector<uint32_t> digits_;
+
+  void trim() {
+    while (!digits_.empty() && digits_.back() == 0) {
+      digits_.pop_back();
+    }
+  }
+
+public:
+  explicit bigCount(uint64_t value = 0) {
+    for (; value > 0; value >>= 32) {
+      digits_.push_back(static_cast<uint32_t>(value));
+    }
+  }
+
+  bigCount& operator+=(const bigCount& anotherCount) {
+    uint64_t carry = 0;
+    digits_.resize(std::max(digits_.size(), anotherCount.digits_.size()), 0);
+    for (size_t position = 0; position < digits_.size(); ++position) {
+      carry += digits_[position];
+      if (position < anotherCount.digits_.size()) {
+        carry += anotherCount.digits_[position];
+      }
+      digits_[position] = static_cast<uint32_t>(carry);
+      carry >>= 32;
+    }
+    if (carry > 0) {
+      digits_.push_back(static_cast<uint32_t>(carry));
+    }
+    return *this;
+  }
+
+  // anotherCount must not exceed *this.
+  bigCount& operator-=(const bigCount& anotherCount) {
+    int64_t borrow = 0;
+    for (size_t position = 0; position < digits_.size(); ++position) {
+      int64_t current = static_cast<int64_t>(digits_[position]) - borrow;
+      if (position < anotherCount.digits_.size()) {
+        current -= anotherCount.digits_[position];
+      }
+      borrow = (current < 0) ? 1 : 0;
+      digits_[position] = static_cast<uint32_t>(current + (borrow << 32));
+    }
+    assert(borrow == 0);
+    trim();
+    return *this;
+  }
+
+  bigCount operator+(const bigCount& anotherCount) const {
+    bigCount answer = *this;
+    return answer += anotherCount;
+  }
+
+  bigCount operator-(const bigCount& anotherCount) const {
+    bigCount answer = *this;
+    return answer -= anotherCount;
+  }
+
+  bool operator<(const bigCount& anotherCount) const {
+    if (digits_.size() != anotherCount.digits_.size()) {
+      return digits_.size() < anotherCount.digits_.size();
+    }
+    return std::lexicographical_compare(digits_.rbegin(), digits_.rend(), anotherCount.digits_.rbegin(), anotherCount.digits_.rend());
+  }
+
+  bool operator==(const bigCount& anotherCount) const {
+    return digits_ == anotherCount.digits_;
+  }
+
+  std::string toString() const {
+    std::vector<uint32_t> rest = digits_;
+    std::string answer = "";
+    while (!rest.empty()) {
+      uint64_t remainder = 0;
+      for (size_t position = rest.size(); position-- > 0;) {
+        uint64_t current = (remainder << 32) | rest[position];
+        rest[position] = static_cast<uint32_t>(current / 10);
+        remainder = current % 10;
+      }
+      answer += static_cast<char>('0' + remainder);
+      while (!rest.empty() && rest.back() == 0) {
+        rest.pop_back();
+      }
+    }
+    if (answer.empty()) {
+      answer = "0";
+    }
+    return std::string(answer.rbegin(), answer.rend());
+  }
+
+  // Uniform in [0, bound), by rejection over numbers with the bit length of bound.
+  template<typename Trandom>
+  friend bigCount randomBelow(const bigCount& bound, Trandom& randomGenerator) {
+    assert(!bound.digits_.empty());
+    uint32_t topMask = bound.digits_.back();
+    for (int shift = 1; shift < 32; shift <<= 1) {
+      topMask |= topMask >> shift;
+    }
+    std::uniform_int_distribution<uint32_t> digitDistribution;
+    bigCount answer;
+    do {
+      answer.digits_.resize(bound.digits_.size());
+      for (auto& digit: answer.digits_) {
+        digit = digitDistribution(randomGenerator);
+      }
+      answer.digits_.back() &= topMask;
+      answer.trim();
+    } while (!(answer < bound));
+    return answer;
+  }
+};
+
+template<typename Tcount, typename Trandom, typename = std::enable_if_t<std::is_integral<Tcount>::value>>
+Tcount randomBelow(Tcount bound, Trandom& randomGenerator) {
+  return std::uniform_int_distribution<Tcount>(0, bound - 1)(randomGenerator);
+}
+
+// Counts modulo Modulus: only countWords is available, ranking needs exact counts.
+template<uint64_t Modulus>
+class modularCount {
+public:
+  uint64_t value;
+
+  explicit modularCount(uint64_t sameValue = 0):
+    value(sameValue % Modulus) {}
+
+  modularCount operator+(const modularCount& anotherCount) const {
+    return modularCount((value + anotherCount.value) % Modulus);
+  }
+
+  bool operator==(const modularCount& anotherCount) const {
+    return value == anotherCount.value;
+  }
+};
+
+// Number of accepted words of every length, wordCount_[length][vertex] counts words of that length
+// read from vertex. The automaton must be deterministic, the table only grows and is shared by all queries.
+template<typename Tvertex, typename Tletter, typename Tcount = bigCount>
+class finiteAutomaton_wordCounter {
+public: // Must be private, public only for easy-testing
+  std::vector<std::vector<std::pair<Tletter, Tvertex>>> edges_;
+  std::vector<bool> isTerminal_;
+  Tvertex source_;
+  std::vector<std::vector<Tcount>> wordCount_;
+
+public:
+  explicit finiteAutomaton_wordCounter(const finiteAutomaton<Tvertex, Tletter>& automaton):
+    edges_(automaton.vertexCount()),
+    isTerminal_(automaton.isTerminal_),
+    source_(automaton.getSource()) {
+      for (size_t vertex = 0; vertex < automaton.vertexCount(); ++vertex) {
+        for (auto adjacentEdgesIterator = automaton.getBegin(vertex); adjacentEdgesIterator.valid(); adjacentEdgesIterator.next()) {
+          edges_[vertex].push_back({adjacentEdgesIterator.getLetter(), adjacentEdgesIterator.getFinish()});
+        }
+        std::sort(edges_[vertex].begin(), edges_[vertex].end());
+        for (size_t position = 1; position < edges_[vertex].size(); ++position) {
+          assert(edges_[vertex][position - 1].first != edges_[vertex][position].first);
+        }
+      }
+      wordCount_.push_back(std::vector<Tcount>(edges_.size(), Tcount(0)));
+      for (size_t vertex = 0; vertex < edges_.size(); ++vertex) {
+        if (isTerminal_[vertex]) {
+          wordCount_[0][vertex] = Tcount(1);
+        }
+      }
+    }
+
+  void prepare(size_t maxLength) {
+    while (wordCount_.size() <= maxLength) {
+      const std::vector<Tcount>& previousCount = wordCount_.back();
+      std::vector<Tcount> currentCount(edges_.size(), Tcount(0));
+      for (size_t vertex = 0; vertex < edges_.size(); ++vertex) {
+        for (const auto& edge: edges_[vertex]) {
+          currentCount[vertex] = currentCount[vertex] + previousCount[edge.second];
+        }
+      }
+      wordCount_.push_back(std::move(currentCount));
+    }
+  }
+
+  Tcount countWords(size_t length) {
+    prepare(length);
+    return wordCount_[length][source_];
+  }
+
+  // The word with index rank (from 0) among accepted words of this length in lexicographic order.
+  std::vector<Tletter> unrank(size_t length, Tcount rank) {
+    prepare(length);
+    assert(rank < wordCount_[length][source_]);
+    std::vector<Tletter> answer;
+    Tvertex vertex = source_;
+    for (size_t restLength = length; restLength > 0; --restLength) {
+      for (const auto& edge: edges_[vertex]) {
+        const Tcount& edgeCount = wordCount_[restLength - 1][edge.second];
+        if (rank < edgeCount) {
+          answer.push_back(edge.first);
+          vertex = edge.second;
+          break;
+        }
+        rank = rank - edgeCount;
+      }
+    }
+    return answer;
+  }
+
+  template<typename Trandom>
+  std::vector<Tletter> sample(size_t length, Trandom& randomGenerator) {
+    return unrank(length, randomBelow(countWords(length), randomGenerator));
+  }
+
+  // Calls onWord for every accepted word of this length in lexicographic order, never entering dead branches.
+  template<typename TwordCallback>
+  void enumerate(size_t length, TwordCallback&& onWord) {
+    prepare(length);
+    if (wordCount_[length][source_] == Tcount(0)) {
+      return;
+    }
+    std::vector<Tletter> word;
+    std::vector<Tvertex> path = {source_};
+    std::vector<size_t> edgePosition = {0};
+    while (!path.empty()) {
+      if (word.size() == length) {
+        onWord(static_cast<const std::vector<Tletter>&>(word));
+      }
+      Tvertex vertex = path.back();
+      size_t restLength = length - word.size();
+      size_t& position = edgePosition.back();
+      while (restLength > 0 && position < edges_[vertex].size() &&
+             wordCount_[restLength - 1][edges_[vertex][position].second] == Tcount(0)) {
+        ++position;
+      }
+      if (restLength == 0 || position == edges_[vertex].size()) {
+        path.pop_back();
+        edgePosition.pop_back();
+        if (!word.empty()) {
+          word.pop_back();
+        }
+        continue;
+      }
+      const auto& edge = edges_[vertex][position++];
+      word.push_back(edge.first);
+      path.push_back(edge.second);
+      edgePosition.push_back(0);
+    }
+  }
+};
@@ -1,87 +1,90 @@
+#pragma once
 #include "finiteAutomatonArithmetic.cpp" 
+#include "finiteAutomatonPathQuery.cpp"
 #include <stack> 
+#include <cctype>
 
 class maxSingleSubstringFinder {
 public: //must be private, public only for easy-testing
   finiteAutomaton<int, char> base;
 
+  // Reads a non-empty run of digits starting at position, returns the position after it.
+  static size_t readNumber(const std::string& str, size_t position, size_t& number) {
+    assert(position < str.size() && std::isdigit(static_cast<unsigned char>(str[position])));
+    number = 0;
+    for (; position < str.size() && std::isdigit(static_cast<unsigned char>(str[position])); ++position) {
+      assert(number <= (unboundedRepetition - 1 - (str[position] - '0')) / 10);
+      number = number * 10 + static_cast<size_t>(str[position] - '0');
+    }
+    return position;
+  }
+
+  // Reads "{n}", "{n,}" or "{n,m}" starting at position, returns the position of '}'.
+  static size_t readRepetitionBounds(const std::string& str, size_t position, size_t& minCount, size_t& maxCount) {
+    position = readNumber(str, position + 1, minCount);
+    maxCount = minCount;
+    if (position < str.size() && str[position] == ',') {
+      ++position;
+      maxCount = unboundedRepetition;
+      if (position < str.size() && str[position] != '}') {
+        position = readNumber(str, position, maxCount);
+      }
+    }
+    assert(position < str.size() && str[position] == '}');
+    assert(minCount <= maxCount);
+    return position;
+  }
+
   maxSingleSubstringFinder(std::string str): base(finiteAutomaton<int, char>(1, 0, std::vector<int>({0}))) {
     std::stack<finiteAutomaton<int, char>> elements;
-    for (char letter: str) {
+    for (size_t position = 0; position < str.size(); ++position) {
+      char letter = str[position];
+      if (letter == '{') {
+        auto lastElement = std::move(elements.top());
+        elements.pop();
+        size_t minCount = 0;
+        size_t maxCount = 0;
+        position = readRepetitionBounds(str, position, minCount, maxCount);
+        elements.push(repetition<int, char>(std::move(lastElement), minCount, maxCount));
+        continue;
+      }
       if (letter == '*') {
-        auto lastElement = elements.top();
+        auto lastElement = std::move(elements.top());
         elements.pop();
-        elements.push(closure<int, char>(lastElement));
+        elements.push(closure<int, char>(std::move(lastElement)));
         continue;
       }
       if (letter == '+') {
-        auto secondTerm = elements.top();
+        auto secondTerm = std::move(elements.top());
         elements.pop();
-        auto firstTerm = elements.top();
+        auto firstTerm = std::move(elements.top());
         elements.pop();
-        elements.push(sum<int, char>(firstTerm, secondTerm));
+        elements.push(sum<int, char>(std::move(firstTerm), std::move(secondTerm)));
         continue;
       }
       if (letter == '.') {
-        auto secondTerm = elements.top();
+        auto secondTerm = std::move(elements.top());
         elements.pop();
-        auto firstTerm = elements.top();
+        auto firstTerm = std::move(elements.top());
         elements.pop();
-        elements.push(concatenation<int, char>(firstTerm, secondTerm));
+        elements.push(concatenation<int, char>(std::move(firstTerm), std::move(secondTerm)));
         continue;
       }
       finiteAutomaton<int, char> current(2, 0, std::vector<int>({1}));
       current.insertEdge(0, 1, (letter == '1') ? defaultZeroLetter<char>() : letter);
-      elements.push(current);
+      elements.push(std::move(current));
     }
-    base = elements.top();
+    base = std::move(elements.top());
     elements.pop();
     assert(elements.empty());
-    base = base.eraseZeroEdges(defaultZeroLetter<char>());
-    base = base.makeFull(std::vector<char>({'a', 'b', 'c'}));
-    base = base.determine();
-    base = base.minimize();
+    base = std::move(base).compile(defaultZeroLetter<char>(), std::vector<char>({'a', 'b', 'c'}));
   }
 
-  void dfsFindPossibleStarts(int vertex, std::vector<bool>& isVertexUsed) {
-    isVertexUsed[vertex] = true;
-    for (auto adjacentEdgesIterator = base.getBegin(vertex); adjacentEdgesIterator.valid(); adjacentEdgesIterator.next()) {
-      int adjacentVertex = adjacentEdgesIterator.getFinish();
-      if (!isVertexUsed[adjacentVertex]) {
-        dfsFindPossibleStarts(adjacentVertex, isVertexUsed);
-      }
-    }
-  }
-
-  int execute(char letter) {
-    std::vector<bool> isVertexReachableFromSource(base.vertexCount(), false);
-    dfsFindPossibleStarts(base.getSource(), isVertexReachableFromSource);
-    std::vector<int> bestPathLength(base.vertexCount(), -1);
-    for (auto vertex: base.getTerminals()) {
-      bestPathLength[vertex] = 0;
-    }
-    int numberOfIterations = 2 * base.vertexCount() + 12;
-    while (numberOfIterations--) {
-      for (auto edge: base.getEdges()) {
-        if (bestPathLength[edge.finish] == -1) {
-          continue;
-        }
-        if (edge.letter == letter) {
-          bestPathLength[edge.start] = std::max(bestPathLength[edge.start], bestPathLength[edge.finish] + 1);
-        } else {
-          bestPathLength[edge.start] = std::max(bestPathLength[edge.start], 0);
-        }
-      }
-    }
-    int answer = 0;
-    for (int vertex = 0; vertex < base.vertexCount(); ++vertex) {
-      if (isVertexReachableFromSource[vertex]) {
-        answer = std::max(answer, bestPathLength[vertex]);
-      }
-    }
-    if (answer > base.vertexCount()) {
+  int execute(char letter) const {
+    long long answer = getLongestLetterRun<int, char>(base, std::vector<char>({letter}));
+    if (answer == maxPlusSemiring<long long>::infinity()) {
       return -1;
     }
-    return answer;
+    return static_cast<int>(std::max(answer, 0LL));
   }
 };
@@ -1,6 +1,33 @@
 #include "maxSingleSubstringFinder.cpp" 
+#include "finiteAutomatonSearcher.cpp"
+#include "finiteAutomatonParallelScanner.cpp"
+#include "finiteAutomatonCompileTime.cpp"
+#include "finiteAutomatonDictionaryBuilder.cpp"
+#include "finiteAutomatonWordCounter.cpp"
+#include "finiteAutomatonMultiPattern.cpp"
+#include "finiteAutomatonLayout.cpp"
+#include "finiteAutomatonIncrementalMinimizer.cpp"
+#include "finiteAutomatonInclusion.cpp"
+#include "finiteAutomatonCompressedTable.cpp"
+#include <fstream>
+#include <memory_resource>
+#include <thread>
 #include <gtest/gtest.h>
 
+// Words over {a, b} with the letter a at position suffixLength + 1 from the end: suffixLength + 2 vertices,
+// but 2^(suffixLength + 1) vertices in the minimal DFA.
+finiteAutomaton<int, char> getLetterFromEndAutomaton(int suffixLength) {
+  finiteAutomaton<int, char> letterFromEnd(suffixLength + 2, 0, std::vector<int>({suffixLength + 1}));
+  letterFromEnd.insertEdge(0, 0, 'a');
+  letterFromEnd.insertEdge(0, 0, 'b');
+  letterFromEnd.insertEdge(0, 1, 'a');
+  for (int vertex = 1; vertex <= suffixLength; ++vertex) {
+    letterFromEnd.insertEdge(vertex, vertex + 1, 'a');
+    letterFromEnd.insertEdge(vertex, vertex + 1, 'b');
+  }
+  return letterFromEnd;
+}
+
 class TestFiniteAutomaton: public ::testing::Test {
 protected:
   finiteAutomaton<int, char>* foo;
@@ -122,6 +149,48 @@ TEST_F(TestFiniteAutomaton, minimize_bigTest) {
   ASSERT_EQ(answer.getHash(), "0>a>1,0>b>1,1>a>0,1>b>0|1");
 }
 
+TEST_F(TestFiniteAutomaton, compile_sameAsStageByStage) {
+  foo = new finiteAutomaton<int, char>(6, 0, std::vector<int>({2}));
+  foo->insertEdge(0, 1, 'a');
+  foo->insertEdge(1, 2, 'b');
+  foo->insertEdge(0, 5, 'b');
+  foo->insertEdge(5, 2, 'a');
+  foo->insertEdge(0, 3, '.');
+  foo->insertEdge(3, 2, '.');
+  foo->insertEdge(3, 4, 'a');
+  foo->insertEdge(4, 3, 'b');
+  auto expected = foo->eraseZeroEdges('.');
+  expected = expected.makeFull(std::vector<char>({'a', 'b'}));
+  expected = expected.determine();
+  expected = expected.minimize();
+  ASSERT_EQ(foo->compile('.', std::vector<char>({'a', 'b'})).getHash(), expected.getHash());
+  auto copy = *foo;
+  ASSERT_EQ(std::move(copy).compile('.', std::vector<char>({'a', 'b'})).getHash(), expected.getHash());
+}
+
+TEST_F(TestFiniteAutomaton, reduce_uselessAndBisimilarVertices) {
+  foo = new finiteAutomaton<int, char>(6, 0, std::vector<int>({3, 5}));
+  foo->insertEdge(0, 1, 'a');
+  foo->insertEdge(0, 2, 'a');
+  foo->insertEdge(1, 3, 'b');
+  foo->insertEdge(2, 3, 'b');
+  foo->insertEdge(0, 4, 'c');
+  foo->insertEdge(5, 3, 'a');
+  ASSERT_EQ(foo->reduce().getHash(), "0>a>1,1>b>2|2");
+}
+
+TEST_F(TestFiniteAutomaton, rvalueOverloads_sameAsLvalue) {
+  foo = new finiteAutomaton<int, char>(4, 0, std::vector<int>({3}));
+  foo->insertEdge(0, 1, 'a');
+  foo->insertEdge(0, 3, 'b');
+  foo->insertEdge(1, 2, 'a');
+  foo->insertEdge(1, 3, 'b');
+  auto copy = *foo;
+  ASSERT_EQ(std::move(copy).makeFull(std::vector<char>({'a', 'b'})).negatate().getHash(),
+            foo->makeFull(std::vector<char>({'a', 'b'})).negatate().getHash());
+  ASSERT_EQ(foo->getHash(), "0>a>1,0>b>3,1>a>2,1>b>3|3");
+}
+
 TEST_F(TestFiniteAutomaton, determinator_getSubsetGraph) {
   using Tcort = std::vector<int>;
   foo = new finiteAutomaton<int, char>(1, 0, std::vector<int>({0}));
@@ -147,6 +216,120 @@ TEST_F(TestFiniteAutomaton, minimizer_getClassGraph) {
   ASSERT_EQ(fooMinimizer.getClassesGraph(std::vector<int>({0, 1, 1, 2}), 3).getHash(), "0>a>1,0>b>1,1>x>2|2");
 }
 
+TEST_F(TestFiniteAutomaton, reduce_thompsonAutomaton) {
+  finiteAutomaton<int, char> letterA(2, 0, std::vector<int>({1}));
+  letterA.insertEdge(0, 1, 'a');
+  finiteAutomaton<int, char> letterB(2, 0, std::vector<int>({1}));
+  letterB.insertEdge(0, 1, 'b');
+  finiteAutomaton<int, char> thompson = concatenation<int, char>(closure<int, char>(sum<int, char>(sum<int, char>(letterA, letterB), letterA)),
+                                                                 concatenation<int, char>(letterB, closure<int, char>(letterB)));
+  finiteAutomaton<int, char> withoutZeroEdges = thompson.eraseZeroEdges('.');
+  finiteAutomaton<int, char> reduced = withoutZeroEdges.reduce();
+  ASSERT_LT(reduced.vertexCount() * 3, withoutZeroEdges.vertexCount());
+  finiteAutomaton_inclusionChecker<int, char> forwardChecker(withoutZeroEdges, reduced);
+  ASSERT_TRUE(forwardChecker.execute());
+  finiteAutomaton_inclusionChecker<int, char> backwardChecker(reduced, withoutZeroEdges);
+  ASSERT_TRUE(backwardChecker.execute());
+}
+
+TEST_F(TestFiniteAutomaton, sharedHandle_concurrentReads) {
+  const maxSingleSubstringFinder finder("ab+c.aba.*.bac.+.+*");
+  finiteAutomaton_sharedHandle<int, char> shared = maxSingleSubstringFinder("ab+*c.").base.share();
+  const std::string expectedHash = shared->getHash();
+  std::vector<int> isCorrect(4, 0);
+  std::vector<std::thread> workers;
+  for (size_t worker = 0; worker < isCorrect.size(); ++worker) {
+    workers.emplace_back([&, worker]() {
+      bool isWorkerCorrect = true;
+      for (int run = 0; run < 50; ++run) {
+        isWorkerCorrect = isWorkerCorrect && shared->accepts(std::string("abac")) && !shared->accepts(std::string("abca"));
+        isWorkerCorrect = isWorkerCorrect && (shared->getHash() == expectedHash) && (finder.execute('a') == 2);
+      }
+      isCorrect[worker] = isWorkerCorrect ? 1 : 0;
+    });
+  }
+  for (auto& worker: workers) {
+    worker.join();
+  }
+  ASSERT_EQ(isCorrect, std::vector<int>(4, 1));
+}
+
+TEST_F(TestFiniteAutomaton, runControl_cancelAndDeadline) {
+  finiteAutomaton<int, char> letterFromEnd = getLetterFromEndAutomaton(14);
+  finiteAutomaton_cancellationToken token;
+  size_t maxLeftCount = 0;
+  finiteAutomaton_runControl cancelledControl(&token, finiteAutomaton_runControl::Tclock::time_point::max(), [&](size_t doneCount, size_t leftCount) {
+    maxLeftCount = std::max(maxLeftCount, leftCount);
+    if (doneCount == 100) {
+      token.cancel();
+    }
+  });
+  finiteAutomaton<int, char> stopped = letterFromEnd.determine(cancelledControl);
+  ASSERT_TRUE(cancelledControl.isStopped());
+  ASSERT_EQ(stopped.vertexCount(), 1u);
+  ASSERT_GT(maxLeftCount, 0u);
+  finiteAutomaton_runControl expiredControl(nullptr, finiteAutomaton_runControl::Tclock::now());
+  ASSERT_EQ(letterFromEnd.getExpression(expiredControl), "");
+  ASSERT_TRUE(expiredControl.isStopped());
+  finiteAutomaton<int, char> firstLetter(3, 0, std::vector<int>({1}));
+  firstLetter.insertEdge(0, 1, 'a');
+  firstLetter.insertEdge(1, 1, 'b');
+  firstLetter.insertEdge(0, 2, 'b');
+  finiteAutomaton_runControl longControl(nullptr, finiteAutomaton_runControl::Tclock::now() + std::chrono::hours(1));
+  ASSERT_EQ(firstLetter.compile('.', std::vector<char>({'a', 'b'}), longControl).getHash(),
+            firstLetter.compile('.', std::vector<char>({'a', 'b'})).getHash());
+  ASSERT_FALSE(longControl.isStopped());
+}
+
+class countingResource: public std::pmr::memory_resource {
+public:
+  size_t allocationCount = 0;
+
+private:
+  void* do_allocate(size_t bytes, size_t alignment) override {
+    ++allocationCount;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void* pointer, size_t bytes, size_t alignment) override {
+    std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource& anotherResource) const noexcept override {
+    return this == &anotherResource;
+  }
+};
+
+// The automata live in the resource heap, nothing may fall back to the default resource. With an arena only
+// the copy of the answer is allocated in heap: its terminal flags, its list of vertices and the edges of every vertex.
+// EXPECT, not ASSERT, so the default resource is always restored.
+TEST_F(TestFiniteAutomaton, compileWithMemoryResource) {
+  using TpmrAutomaton = finiteAutomaton<int, char, std::pmr::polymorphic_allocator<int>>;
+  countingResource defaultResource;
+  std::pmr::memory_resource* previousDefaultResource = std::pmr::set_default_resource(&defaultResource);
+  for (std::string pattern: {"ab+c.aba.*.bac.+.+*", "acb..bab.c.*.ab.ba.+.+*a.", "ab.{2,4}c*."}) {
+    maxSingleSubstringFinder finder(pattern);
+    countingResource heap;
+    TpmrAutomaton base = finder.base.copyWithAllocator(std::pmr::polymorphic_allocator<int>(&heap));
+    heap.allocationCount = 0;
+    TpmrAutomaton plain = base.compile('.', {'a', 'b', 'c'});
+    size_t plainHeapCount = heap.allocationCount;
+    countingResource arenaUpstream;
+    std::pmr::monotonic_buffer_resource arena(&arenaUpstream);
+    heap.allocationCount = 0;
+    TpmrAutomaton withArena = base.compile('.', {'a', 'b', 'c'}, &arena);
+    EXPECT_GT(arenaUpstream.allocationCount, 0u);
+    EXPECT_LE(heap.allocationCount, withArena.vertexCount() + 2);
+    EXPECT_LT(heap.allocationCount, plainHeapCount);
+    EXPECT_EQ(withArena.getHash(), plain.getHash());
+    EXPECT_EQ(withArena.getHash(), finder.base.compile('.', {'a', 'b', 'c'}).getHash());
+    EXPECT_EQ(base.makeFull({'a', 'b', 'c'}).getAllocator().resource(), &heap);
+    EXPECT_EQ(withArena.negatate().getAllocator().resource(), &heap);
+  }
+  std::pmr::set_default_resource(previousDefaultResource);
+  ASSERT_EQ(defaultResource.allocationCount, 0u);
+}
+
 class TestFiniteAutomatonArithmetic: public ::testing::Test {
 protected:
   finiteAutomaton<int, char>* fooFirstTerm;
@@ -202,6 +385,60 @@ TEST_F(TestFiniteAutomatonArithmetic, simpleClosure) {
   ASSERT_EQ(result.getHash(), "0>.>3,1>.>0,2>.>1,2>c>3,3>a>2,3>a>4,4>.>1,4>b>2|0,1");
 }
 
+TEST_F(TestFiniteAutomatonArithmetic, simpleReversal) {
+  fooFirstTerm = new finiteAutomaton<int, char>(3, 0, std::vector<int>({2}));
+  fooFirstTerm->insertEdge(0, 1, 'a');
+  fooFirstTerm->insertEdge(1, 2, 'b');
+  fooFirstTerm->insertEdge(2, 2, 'c');
+  finiteAutomaton<int, char> result = reversal<int, char>(*fooFirstTerm);
+  ASSERT_EQ(result.getHash(), "1>a>0,2>b>1,2>c>2,3>.>2|0");
+}
+
+TEST_F(TestFiniteAutomatonArithmetic, simpleRepetition) {
+  fooFirstTerm = new finiteAutomaton<int, char>(2, 0, std::vector<int>({1}));
+  fooFirstTerm->insertEdge(0, 1, 'a');
+  finiteAutomaton<int, char> result = repetition<int, char>(*fooFirstTerm, 1, 2);
+  ASSERT_EQ(result.getHash(), "0>.>2,2>a>3,3>.>1,3>.>4,4>a>5,5>.>1|1");
+  result = repetition<int, char>(*fooFirstTerm, 0, unboundedRepetition);
+  ASSERT_EQ(result.getHash(), "0>.>1,0>.>2,2>a>3,3>.>1,3>.>2|1");
+}
+
+class TestFiniteAutomatonSearcher: public ::testing::Test {
+protected:
+  finiteAutomaton_searcher<int, char>* searcher;
+
+  void SetUp() {
+    finiteAutomaton<int, char> pattern(3, 0, std::vector<int>({2}));
+    pattern.insertEdge(0, 1, 'a');
+    pattern.insertEdge(1, 2, 'b');
+    pattern.insertEdge(2, 2, 'b');
+    searcher = new finiteAutomaton_searcher<int, char>(pattern);
+  }
+
+  void TearDown() {
+    delete searcher;
+  }
+};
+
+TEST_F(TestFiniteAutomatonSearcher, matchEndsAcrossChunks) {
+  std::string text = "xabbab abx";
+  std::vector<size_t> matchEnds;
+  searcher->findMatchEnds(text.data(), text.size(), [&](size_t matchEnd) { matchEnds.push_back(matchEnd); }, 3);
+  ASSERT_EQ(matchEnds, std::vector<size_t>({3, 4, 6, 9}));
+}
+
+TEST_F(TestFiniteAutomatonSearcher, matchStartsFromMappedFile) {
+  std::string path = ::testing::TempDir() + "finiteAutomatonSearcherTest.txt";
+  std::ofstream(path) << "xabbab abx";
+  std::vector<std::pair<size_t, size_t>> matches;
+  ASSERT_TRUE(searcher->findMatchesInFile(path, [&](size_t matchStart, size_t matchEnd) {
+    matches.push_back({matchStart, matchEnd});
+  }));
+  std::remove(path.c_str());
+  ASSERT_EQ(matches, (std::vector<std::pair<size_t, size_t>>({{1, 3}, {1, 4}, {4, 6}, {7, 9}})));
+  ASSERT_FALSE(searcher->findMatchEndsInFile(path, [](size_t) {}));
+}
+
 class TestMaxSingleSubstringFinder: public ::testing::Test {
 protected:
   maxSingleSubstringFinder* algorithmInstance;
@@ -232,6 +469,558 @@ TEST_F(TestMaxSingleSubstringFinder, simpleMainTest2) {
   ASSERT_EQ(algorithmInstance->execute('a'), 2);
 }
 
+TEST_F(TestMaxSingleSubstringFinder, countedRepetition) {
+  algorithmInstance = new maxSingleSubstringFinder("ab+{2,3}c.");
+  finiteAutomaton_wordCounter<int, char, unsigned long long> counter(algorithmInstance->base);
+  std::vector<unsigned long long> expectedCounts = {0, 0, 0, 4, 8, 0, 0};
+  for (size_t length = 0; length < expectedCounts.size(); ++length) {
+    ASSERT_EQ(counter.countWords(length), expectedCounts[length]);
+  }
+  delete algorithmInstance;
+  algorithmInstance = new maxSingleSubstringFinder("a{2,}b{0}.c{0,1}.");
+  ASSERT_EQ(getShortestWordLength(algorithmInstance->base), 2);
+  ASSERT_EQ(getLongestWordLength(algorithmInstance->base), maxPlusSemiring<long long>::infinity());
+  ASSERT_EQ(algorithmInstance->execute('b'), 0);
+  ASSERT_EQ(algorithmInstance->execute('c'), 1);
+  delete algorithmInstance;
+  algorithmInstance = new maxSingleSubstringFinder("ba{1,300}.");
+  ASSERT_EQ(getLongestWordLength(algorithmInstance->base), 301);
+  ASSERT_EQ(algorithmInstance->execute('a'), 300);
+  delete algorithmInstance;
+  algorithmInstance = new maxSingleSubstringFinder("ba{1,3000}.");
+  ASSERT_EQ(algorithmInstance->base.vertexCount(), 3003u);
+  ASSERT_EQ(algorithmInstance->execute('a'), 3000);
+  delete algorithmInstance;
+  algorithmInstance = new maxSingleSubstringFinder("a*{1,5000}");
+  ASSERT_EQ(algorithmInstance->base.compile('.', {'a', 'b'}).getHash(),
+            maxSingleSubstringFinder("a*").base.compile('.', {'a', 'b'}).getHash());
+  delete algorithmInstance;
+  algorithmInstance = new maxSingleSubstringFinder("a1+{2,3}");
+  finiteAutomaton<int, char> nullableRepetition = algorithmInstance->base.eraseZeroEdges('.');
+  ASSERT_TRUE(nullableRepetition.accepts(std::string("")));
+  ASSERT_TRUE(nullableRepetition.accepts(std::string("aaa")));
+  ASSERT_FALSE(nullableRepetition.accepts(std::string("aaaa")));
+  size_t minCount = 0;
+  size_t maxCount = 0;
+  ASSERT_EQ(maxSingleSubstringFinder::readRepetitionBounds("a{12,}", 1, minCount, maxCount), 5u);
+  ASSERT_EQ(minCount, 12u);
+  ASSERT_EQ(maxCount, unboundedRepetition);
+  ASSERT_EQ(maxSingleSubstringFinder::readRepetitionBounds("a{3,40}", 1, minCount, maxCount), 6u);
+  ASSERT_EQ(maxCount, 40u);
+}
+
+class TestFiniteAutomatonParallelScanner: public ::testing::Test {
+protected:
+  finiteAutomaton_parallelScanner<int, char>* scanner;
+
+  void SetUp() {
+    scanner = new finiteAutomaton_parallelScanner<int, char>(maxSingleSubstringFinder("ab.*c.ab+*.").base);
+  }
+
+  void TearDown() {
+    delete scanner;
+  }
+};
+
+TEST_F(TestFiniteAutomatonParallelScanner, matchesSequentialRun) {
+  std::string text = "";
+  for (int repeat = 0; repeat < 500; ++repeat) {
+    text += "ab";
+  }
+  text += "cbaab";
+  std::vector<int> boundaries = scanner->getBoundaryVertices(text.data(), text.size(), 7, 1);
+  ASSERT_EQ(boundaries.size(), 8);
+  size_t chunkSize = (text.size() + 6) / 7;
+  for (size_t chunk = 0; chunk + 1 < boundaries.size(); ++chunk) {
+    size_t chunkEnd = std::min(text.size(), (chunk + 1) * chunkSize);
+    ASSERT_EQ(boundaries[chunk + 1], scanner->runChunk(scanner->table_.source, text.data(), chunkEnd));
+  }
+  ASSERT_TRUE(scanner->accepts(text.data(), text.size(), 7, 1));
+  text += "c";
+  ASSERT_FALSE(scanner->accepts(text.data(), text.size(), 4, 1));
+  ASSERT_EQ(scanner->accepts(text.data(), text.size(), 1), scanner->accepts(text.data(), text.size(), 4, 1));
+}
+
+TEST_F(TestFiniteAutomatonParallelScanner, composeMappings) {
+  using TparallelScanner = finiteAutomaton_parallelScanner<int, char>;
+  using TstateMapping = TparallelScanner::TstateMapping;
+  TstateMapping first = {1, 2, 0};
+  TstateMapping second = {0, 0, 2};
+  ASSERT_EQ(TparallelScanner::composeMappings(first, second), TstateMapping({0, 2, 0}));
+  std::vector<TstateMapping> mappings = {first, second, {2, 1, 1}, {1, 1, 0}, first, second, {2, 2, 1}};
+  std::vector<TstateMapping> prefixes = mappings;
+  TparallelScanner::composePrefixes(prefixes);
+  TstateMapping expectedPrefix = {0, 1, 2};
+  for (size_t chunk = 0; chunk < mappings.size(); ++chunk) {
+    expectedPrefix = TparallelScanner::composeMappings(expectedPrefix, mappings[chunk]);
+    ASSERT_EQ(prefixes[chunk], expectedPrefix);
+  }
+}
+
+class TestFiniteAutomatonCompileTime: public ::testing::Test {
+protected:
+  finiteAutomaton<int, char>* pattern;
+
+  void SetUp() {
+    pattern = new finiteAutomaton<int, char>(maxSingleSubstringFinder("ab+c.aba.*.bac.+.+*").base);
+  }
+
+  void TearDown() {
+    delete pattern;
+  }
+};
+
+TEST_F(TestFiniteAutomatonCompileTime, sameLanguage) {
+  static constexpr auto compiled = compileRpnPattern("ab+c.aba.*.bac.+.+*");
+  static_assert(compiled.accepts("acab"), "built at compile time");
+  static_assert(!compiled.accepts("aba"), "built at compile time");
+  std::vector<std::string> words = {""};
+  for (size_t wordsBegin = 0; words[wordsBegin].size() < 6; ++wordsBegin) {
+    for (char letter: std::string("abc")) {
+      words.push_back(words[wordsBegin] + letter);
+    }
+  }
+  for (const auto& word: words) {
+    int vertex = pattern->getSource();
+    for (char letter: word) {
+      for (auto adjacentEdgesIterator = pattern->getBegin(vertex); adjacentEdgesIterator.valid(); adjacentEdgesIterator.next()) {
+        if (adjacentEdgesIterator.getLetter() == letter) {
+          vertex = adjacentEdgesIterator.getFinish();
+          break;
+        }
+      }
+    }
+    ASSERT_EQ(compiled.accepts(word), static_cast<bool>(pattern->isTerminal_[vertex])) << word;
+  }
+  ASSERT_EQ(compiled.toFiniteAutomaton().minimize().vertexCount(), compiled.vertexCount());
+}
+
+class TestFiniteAutomatonWordCounter: public ::testing::Test {
+protected:
+  finiteAutomaton<int, char>* pattern;
+
+  void SetUp() {
+    pattern = new finiteAutomaton<int, char>(maxSingleSubstringFinder("ab+*c.").base);
+  }
+
+  void TearDown() {
+    delete pattern;
+  }
+};
+
+TEST_F(TestFiniteAutomatonWordCounter, countAndRank) {
+  finiteAutomaton_wordCounter<int, char> counter(*pattern);
+  ASSERT_EQ(counter.countWords(0).toString(), "0");
+  ASSERT_EQ(counter.countWords(3).toString(), "4");
+  ASSERT_EQ(counter.countWords(100).toString(), "633825300114114700748351602688");
+  ASSERT_EQ(counter.unrank(3, bigCount(0)), std::vector<char>({'a', 'a', 'c'}));
+  ASSERT_EQ(counter.unrank(3, bigCount(3)), std::vector<char>({'b', 'b', 'c'}));
+  std::vector<std::string> words;
+  counter.enumerate(3, [&](const std::vector<char>& word) { words.push_back(std::string(word.begin(), word.end())); });
+  ASSERT_EQ(words, std::vector<std::string>({"aac", "abc", "bac", "bbc"}));
+  finiteAutomaton_wordCounter<int, char, modularCount<1000000007>> modularCounter(*pattern);
+  ASSERT_EQ(modularCounter.countWords(100).value, 988185646);
+}
+
+TEST_F(TestFiniteAutomatonWordCounter, uniformSample) {
+  finiteAutomaton_wordCounter<int, char, unsigned long long> counter(*pattern);
+  std::mt19937_64 randomGenerator(12);
+  std::map<std::string, int> sampled;
+  for (int iteration = 0; iteration < 400; ++iteration) {
+    auto word = counter.sample(3, randomGenerator);
+    ++sampled[std::string(word.begin(), word.end())];
+  }
+  ASSERT_EQ(sampled.size(), 4);
+  for (const auto& word: sampled) {
+    ASSERT_EQ(word.first.back(), 'c');
+    ASSERT_GT(word.second, 50);
+  }
+  bigCount bound(1000);
+  bound += bigCount(static_cast<uint64_t>(1) << 40);
+  ASSERT_TRUE(randomBelow(bound, randomGenerator) < bound);
+}
+
+class TestFiniteAutomatonPathQuery: public ::testing::Test {
+protected:
+  maxSingleSubstringFinder* algorithmInstance;
+
+  void SetUp() {
+    algorithmInstance = nullptr;
+  }
+
+  void TearDown() {
+    if (algorithmInstance != nullptr) { 
+      delete algorithmInstance;
+    }
+  }
+};
+
+TEST_F(TestFiniteAutomatonPathQuery, wordLengthsAndCosts) {
+  algorithmInstance = new maxSingleSubstringFinder("ab.c+ab.ab..+");
+  ASSERT_EQ(getShortestWordLength(algorithmInstance->base), 1);
+  ASSERT_EQ(getLongestWordLength(algorithmInstance->base), 4);
+  ASSERT_EQ(getMinimalWordCost(algorithmInstance->base, {{'a', 1}, {'b', 1}, {'c', 5}}), 2);
+  ASSERT_EQ(getLongestLetterRun(algorithmInstance->base, std::vector<char>({'a', 'b'})), 4);
+  delete algorithmInstance;
+  algorithmInstance = new maxSingleSubstringFinder("a*b.");
+  ASSERT_EQ(getLongestWordLength(algorithmInstance->base), maxPlusSemiring<long long>::infinity());
+  ASSERT_EQ(getLongestLetterRun(algorithmInstance->base, std::vector<char>({'b'})), 1);
+  ASSERT_EQ(algorithmInstance->execute('a'), -1);
+  ASSERT_EQ(algorithmInstance->execute('c'), 0);
+}
+
+TEST_F(TestFiniteAutomatonPathQuery, emptyLanguage) {
+  finiteAutomaton<int, char> empty(2, 0, std::vector<int>());
+  empty.insertEdge(0, 1, 'a');
+  empty.insertEdge(1, 0, 'a');
+  ASSERT_EQ(getShortestWordLength(empty), minPlusSemiring<long long>::zero());
+  finiteAutomaton_pathQuery<int, char, maxPlusSemiring<long long>> query(empty, [](const auto&) { return 1LL; });
+  ASSERT_FALSE(query.isUseful(0));
+}
+
+class TestFiniteAutomatonMultiPattern: public ::testing::Test {
+protected:
+  std::vector<finiteAutomaton<int, char>> patterns;
+
+  void SetUp() {
+    for (std::string pattern: {"ab.", "a*b.", "ab+*"}) {
+      patterns.push_back(maxSingleSubstringFinder(pattern).base);
+    }
+    finiteAutomaton<int, char> withZeroEdges(3, 0, std::vector<int>({2}));
+    withZeroEdges.insertEdge(0, 1, '.');
+    withZeroEdges.insertEdge(1, 2, 'b');
+    patterns.push_back(withZeroEdges);
+  }
+};
+
+TEST_F(TestFiniteAutomatonMultiPattern, reportsEveryPattern) {
+  finiteAutomaton_multiPattern<int, char> united(patterns);
+  ASSERT_EQ(united.match(std::string("ab")), std::vector<int>({0, 1, 2}));
+  ASSERT_EQ(united.match(std::string("aab")), std::vector<int>({1, 2}));
+  ASSERT_EQ(united.match(std::string("b")), std::vector<int>({1, 2, 3}));
+  ASSERT_EQ(united.match(std::string("")), std::vector<int>({2}));
+  ASSERT_EQ(united.match(std::string("ba")), std::vector<int>({2}));
+  ASSERT_EQ(united.match(std::string("c")), std::vector<int>());
+  ASSERT_EQ(united.match(std::string("x")), std::vector<int>());
+  finiteAutomaton<int, char> deterministic = united.getAutomaton();
+  ASSERT_LT(deterministic.minimize().vertexCount(), united.getAutomaton().vertexCount());
+}
+
+TEST_F(TestFiniteAutomatonMultiPattern, noIsolatedVertices) {
+  finiteAutomaton<int, char> aStar(1, 0, std::vector<int>({0}));
+  aStar.insertEdge(0, 0, 'a');
+  finiteAutomaton_multiPattern<int, char> everyWord(std::vector<finiteAutomaton<int, char>>({aStar}));
+  ASSERT_EQ(everyWord.getAutomaton().vertexCount(), 1u);
+  ASSERT_EQ(everyWord.match(std::string("aaa")), std::vector<int>({0}));
+  ASSERT_EQ(everyWord.match(std::string("ab")), std::vector<int>());
+  finiteAutomaton_multiPattern<int, char> united(patterns);
+  std::vector<bool> isUsedPatternSet(united.patternSets_.size(), false);
+  for (size_t vertex = 0; vertex < united.getAutomaton().vertexCount(); ++vertex) {
+    isUsedPatternSet[united.patternSet_[vertex]] = true;
+  }
+  ASSERT_EQ(std::count(isUsedPatternSet.begin(), isUsedPatternSet.end(), false), 0);
+}
+
+class TestFiniteAutomatonDictionaryBuilder: public ::testing::Test {
+protected:
+  finiteAutomaton_dictionaryBuilder<int, char>* builder;
+
+  void SetUp() {
+    builder = new finiteAutomaton_dictionaryBuilder<int, char>();
+  }
+
+  void TearDown() {
+    delete builder;
+  }
+};
+
+TEST_F(TestFiniteAutomatonDictionaryBuilder, sharedSuffixes) {
+  for (std::string word: {"ab", "abc", "b", "b", "bc"}) {
+    builder->insertWord(word);
+  }
+  finiteAutomaton<int, char> automaton = builder->getAutomaton();
+  ASSERT_EQ(automaton.getHash(), "0>a>1,0>b>2,1>b>2,2>c>3|2,3");
+  ASSERT_EQ(builder->vertexCount(), 4);
+  auto complement = automaton.makeFull(std::vector<char>({'a', 'b', 'c'})).negatate().minimize();
+  ASSERT_EQ(complement.negatate().minimize().vertexCount(), automaton.makeFull(std::vector<char>({'a', 'b', 'c'})).minimize().vertexCount());
+}
+
+TEST_F(TestFiniteAutomatonDictionaryBuilder, sameAsMinimize) {
+  std::vector<std::string> words = {"cab", "cabc", "cb", "cbc", "cc", "ccab", "ccb"};
+  finiteAutomaton<int, char> united(1, 0, std::vector<int>());
+  for (const auto& word: words) {
+    builder->insertWord(word);
+    finiteAutomaton<int, char> current(word.size() + 1, 0, std::vector<int>({static_cast<int>(word.size())}));
+    for (size_t position = 0; position < word.size(); ++position) {
+      current.insertEdge(position, position + 1, word[position]);
+    }
+    united = sum<int, char>(united, current);
+  }
+  auto expected = united.compile('.', std::vector<char>({'a', 'b', 'c'}));
+  finiteAutomaton<int, char> automaton = builder->getAutomaton();
+  ASSERT_EQ(automaton.compile('.', std::vector<char>({'a', 'b', 'c'})).vertexCount(), expected.vertexCount());
+  ASSERT_EQ(automaton.vertexCount() + 1, expected.vertexCount());
+}
+
+TEST_F(TestFiniteAutomatonDictionaryBuilder, unsignedOrderAndUnsortedWords) {
+  std::vector<std::string> words = {"a", "b", "\xc3\xa9", "\xc3\xa9t\xc3\xa9"};
+  ASSERT_TRUE(std::is_sorted(words.begin(), words.end()));
+  for (const auto& word: words) {
+    ASSERT_TRUE(builder->insertWord(word));
+  }
+  ASSERT_FALSE(builder->insertWord(std::string("ab")));
+  ASSERT_TRUE(builder->insertWord(std::string("\xc3\xa9t\xc3\xa9")));
+  finiteAutomaton<int, char> automaton = builder->getAutomaton();
+  ASSERT_EQ(builder->vertexCount(), 6);
+  ASSERT_TRUE(automaton.accepts(std::string("\xc3\xa9")));
+  ASSERT_FALSE(automaton.accepts(std::string("ab")));
+}
+
+class TestFiniteAutomatonLayout: public ::testing::Test {
+protected:
+  finiteAutomaton<int, char>* automaton;
+
+  void SetUp() {
+    automaton = new finiteAutomaton<int, char>(4, 3, std::vector<int>({2}));
+    automaton->insertEdge(3, 1, 'a');
+    automaton->insertEdge(3, 0, 'b');
+    automaton->insertEdge(1, 2, 'a');
+  }
+
+  void TearDown() {
+    delete automaton;
+  }
+};
+
+TEST_F(TestFiniteAutomatonLayout, bfsDfsAndProfile) {
+  finiteAutomaton_relayout<int, char> bfsLayout(*automaton);
+  ASSERT_EQ(bfsLayout.execute().getHash(), "0>a>1,0>b>2,1>a>3|3");
+  finiteAutomaton_relayout<int, char> dfsLayout(*automaton, finiteAutomaton_layoutOrder::dfs);
+  ASSERT_EQ(dfsLayout.execute().getHash(), "0>a>1,0>b>3,1>a>2|2");
+  ASSERT_EQ(dfsLayout.getHotVertexCount(), 0u);
+  finiteAutomaton_profile<int, char> profile(*automaton);
+  for (int run = 0; run < 5; ++run) {
+    profile.record(std::string("b"));
+  }
+  profile.record(std::string("aa"));
+  profile.record(std::string("bb"));
+  ASSERT_EQ(profile.getVisitCount(3), 7u);
+  ASSERT_EQ(profile.getTransitionCount(3, 'b'), 6u);
+  finiteAutomaton_relayout<int, char> profileLayout(*automaton, profile, 1);
+  ASSERT_EQ(profileLayout.getHotVertexCount(), 2u);
+  ASSERT_EQ(profileLayout.getNewNumber(0), 1);
+  ASSERT_EQ(profileLayout.execute().getHash(), "0>b>1,0>a>2,2>a>3|3");
+}
+
+TEST_F(TestFiniteAutomatonLayout, hotVertexBehindColdOnes) {
+  finiteAutomaton<int, char> merging(5, 0, std::vector<int>({4}));
+  merging.insertEdge(0, 1, 'a');
+  merging.insertEdge(0, 2, 'b');
+  merging.insertEdge(0, 3, 'c');
+  merging.insertEdge(1, 4, 'a');
+  merging.insertEdge(2, 4, 'a');
+  merging.insertEdge(3, 4, 'a');
+  finiteAutomaton_profile<int, char> profile(merging);
+  profile.record(std::string("aa"));
+  profile.record(std::string("ba"));
+  profile.record(std::string("ca"));
+  ASSERT_EQ(profile.getVisitCount(4), 3u);
+  finiteAutomaton_relayout<int, char> profileLayout(merging, profile, 1);
+  ASSERT_EQ(profileLayout.getHotVertexCount(), 2u);
+  ASSERT_EQ(profileLayout.getNewNumber(0), 0);
+  ASSERT_EQ(profileLayout.getNewNumber(4), 1);
+  ASSERT_EQ(profileLayout.execute().getHash(), "0>a>2,0>b>3,0>c>4,2>a>1,3>a>1,4>a>1|1");
+}
+
+class TestFiniteAutomatonIncrementalMinimizer: public ::testing::Test {
+protected:
+  finiteAutomaton_incrementalMinimizer<int, char>* incremental;
+
+  void SetUp() {
+    incremental = nullptr;
+  }
+
+  void TearDown() {
+    if (incremental != nullptr) {
+      delete incremental;
+    }
+  }
+};
+
+TEST_F(TestFiniteAutomatonIncrementalMinimizer, sameAsDictionary) {
+  std::mt19937 randomGenerator(2024);
+  incremental = new finiteAutomaton_incrementalMinimizer<int, char>();
+  std::set<std::string> words;
+  for (int edit = 0; edit < 300; ++edit) {
+    std::string word(randomGenerator() % 5, 'a');
+    for (auto& letter: word) {
+      letter = static_cast<char>('a' + randomGenerator() % 2);
+    }
+    if (randomGenerator() % 3 == 0) {
+      incremental->removeWord(word);
+      words.erase(word);
+    } else {
+      incremental->addWord(word);
+      words.insert(word);
+    }
+    finiteAutomaton_dictionaryBuilder<int, char> builder;
+    for (const auto& sameWord: words) {
+      builder.insertWord(sameWord);
+    }
+    ASSERT_EQ(incremental->getAutomaton().getHash(), builder.getAutomaton().getHash());
+    ASSERT_EQ(incremental->vertexCount(), builder.vertexCount());
+  }
+}
+
+TEST_F(TestFiniteAutomatonIncrementalMinimizer, cyclicEdits) {
+  finiteAutomaton<int, char> everyWord = maxSingleSubstringFinder("ab+*").base;
+  incremental = new finiteAutomaton_incrementalMinimizer<int, char>(everyWord);
+  ASSERT_EQ(incremental->vertexCount(), 1u);
+  incremental->removeWord(std::string("ab"));
+  ASSERT_EQ(incremental->vertexCount(), 4u);
+  ASSERT_FALSE(incremental->contains(std::string("ab")));
+  ASSERT_TRUE(incremental->contains(std::string("abb")));
+  ASSERT_TRUE(incremental->contains(std::string("ba")));
+  incremental->addWord(std::string("ab"));
+  ASSERT_EQ(incremental->vertexCount(), 1u);
+  finiteAutomaton<int, char> singleWord = maxSingleSubstringFinder("ab.").base;
+  finiteAutomaton_incrementalMinimizer<int, char> edited(singleWord);
+  edited.insertEdge(std::string("a"), 'a', std::string("a"));
+  ASSERT_TRUE(edited.contains(std::string("aab")));
+  ASSERT_TRUE(edited.contains(std::string("ab")));
+  ASSERT_FALSE(edited.contains(std::string("aaab")));
+  ASSERT_EQ(edited.vertexCount(), 4u);
+  edited.eraseEdge(std::string("a"), 'b');
+  ASSERT_FALSE(edited.contains(std::string("ab")));
+  ASSERT_EQ(edited.getAutomaton().getHash(), "0>a>1,1>a>2,2>b>3|3");
+  edited.removeWord(std::string("aab"));
+  ASSERT_EQ(edited.vertexCount(), 1u);
+}
+
+TEST_F(TestFiniteAutomatonIncrementalMinimizer, freesDeadCycles) {
+  finiteAutomaton<int, char> cycle = maxSingleSubstringFinder("abc.*.d+").base;
+  incremental = new finiteAutomaton_incrementalMinimizer<int, char>(cycle);
+  ASSERT_EQ(incremental->vertexCount(), 4u);
+  incremental->eraseEdge(std::string(""), 'a');
+  ASSERT_EQ(incremental->vertexCount(), incremental->getAutomaton().vertexCount());
+  ASSERT_EQ(incremental->vertexCount(), 2u);
+  ASSERT_EQ(incremental->register_.size(), 2u);
+  ASSERT_TRUE(incremental->contains(std::string("d")));
+  incremental->removeWord(std::string("d"));
+  ASSERT_EQ(incremental->vertexCount(), 1u);
+  ASSERT_EQ(incremental->register_.size(), 0u);
+  finiteAutomaton<int, char> selfLoop = maxSingleSubstringFinder("ab*.").base;
+  finiteAutomaton_incrementalMinimizer<int, char> edited(selfLoop);
+  edited.insertEdge(std::string(""), 'a', std::string("ab"));
+  edited.eraseEdge(std::string(""), 'a');
+  ASSERT_EQ(edited.vertexCount(), edited.getAutomaton().vertexCount());
+  ASSERT_EQ(edited.vertexCount(), 1u);
+}
+
+class TestFiniteAutomatonInclusion: public ::testing::Test {
+protected:
+  finiteAutomaton<int, char>* letterA;
+  finiteAutomaton<int, char>* letterB;
+
+  void SetUp() {
+    letterA = new finiteAutomaton<int, char>(2, 0, std::vector<int>({1}));
+    letterA->insertEdge(0, 1, 'a');
+    letterB = new finiteAutomaton<int, char>(2, 0, std::vector<int>({1}));
+    letterB->insertEdge(0, 1, 'b');
+  }
+
+  void TearDown() {
+    delete letterA;
+    delete letterB;
+  }
+};
+
+TEST_F(TestFiniteAutomatonInclusion, antichains) {
+  const int suffixLength = 12;
+  finiteAutomaton<int, char> letterFromEnd = getLetterFromEndAutomaton(suffixLength);
+  finiteAutomaton_inclusionChecker<int, char> sameChecker(letterFromEnd, letterFromEnd);
+  ASSERT_TRUE(sameChecker.execute());
+  ASSERT_LT(sameChecker.exploredCount(), 100u);
+  finiteAutomaton<int, char> everyWord = maxSingleSubstringFinder("ab+*").base;
+  finiteAutomaton_inclusionChecker<int, char> strictChecker(everyWord, letterFromEnd);
+  ASSERT_FALSE(strictChecker.execute());
+  ASSERT_EQ(strictChecker.getCounterexample(), std::vector<char>());
+  finiteAutomaton<int, char> firstLetter = maxSingleSubstringFinder("aab+*.").base;
+  finiteAutomaton_inclusionChecker<int, char> wordChecker(letterFromEnd, firstLetter);
+  ASSERT_FALSE(wordChecker.execute());
+  ASSERT_EQ(wordChecker.getCounterexample().size(), static_cast<size_t>(suffixLength + 2));
+  ASSERT_EQ(wordChecker.getCounterexample().front(), 'b');
+  ASSERT_EQ(wordChecker.getCounterexample()[1], 'a');
+}
+
+TEST_F(TestFiniteAutomatonInclusion, universality) {
+  finiteAutomaton<int, char> everyWord = closure<int, char>(sum<int, char>(*letterA, *letterB)).eraseZeroEdges('.');
+  finiteAutomaton_inclusionChecker<int, char> universalChecker(everyWord, std::vector<char>({'a', 'b'}));
+  ASSERT_TRUE(universalChecker.execute());
+  finiteAutomaton_inclusionChecker<int, char> widerChecker(everyWord, std::vector<char>({'a', 'b', 'c'}));
+  ASSERT_FALSE(widerChecker.execute());
+  ASSERT_EQ(widerChecker.getCounterexample(), std::vector<char>({'c'}));
+  finiteAutomaton<int, char> nonEmptyWord = concatenation<int, char>(sum<int, char>(*letterA, *letterB), everyWord).eraseZeroEdges('.');
+  finiteAutomaton_inclusionChecker<int, char> emptyWordChecker(nonEmptyWord, std::vector<char>({'a', 'b'}));
+  ASSERT_FALSE(emptyWordChecker.execute());
+  ASSERT_EQ(emptyWordChecker.getCounterexample(), std::vector<char>());
+}
+
+class TestFiniteAutomatonCompressedTable: public ::testing::Test {
+protected:
+  finiteAutomaton<int, char>* deterministic;
+
+  void SetUp() {
+    deterministic = new finiteAutomaton<int, char>(getLetterFromEndAutomaton(9).compile('.', std::vector<char>({'a', 'b'})));
+  }
+
+  void TearDown() {
+    delete deterministic;
+  }
+};
+
+TEST_F(TestFiniteAutomatonCompressedTable, sameStepsAsTable) {
+  ASSERT_EQ(deterministic->vertexCount(), 1u << 10);
+  for (bool isMissingLetterDead: {true, false}) {
+    finiteAutomaton_table<int, char> table(*deterministic, isMissingLetterDead);
+    finiteAutomaton_compressedTable<int, char> compressed(*deterministic, isMissingLetterDead);
+    ASSERT_EQ(compressed.vertexCount(), table.vertexCount());
+    ASSERT_EQ(compressed.getSource(), table.source);
+    for (size_t vertex = 0; vertex < table.vertexCount(); ++vertex) {
+      ASSERT_EQ(compressed.isTerminal(vertex), static_cast<bool>(table.isTerminal[vertex]));
+      for (int letter = -128; letter < 128; ++letter) {
+        ASSERT_EQ(compressed.step(vertex, static_cast<char>(letter)), table.step(vertex, static_cast<char>(letter)));
+      }
+    }
+    ASSERT_LT(compressed.memoryUsage() * 10, table.transitions.size() * sizeof(int));
+  }
+}
+
+TEST_F(TestFiniteAutomatonCompressedTable, denseRandomRows) {
+  const int vertexCount = 400;
+  std::mt19937 randomGenerator(42);
+  finiteAutomaton<int, char> randomAutomaton(vertexCount, 0, std::vector<int>({1}));
+  std::vector<int> letters(finiteAutomaton_table<int, char>::tableWidth);
+  for (size_t letter = 0; letter < letters.size(); ++letter) {
+    letters[letter] = static_cast<int>(letter);
+  }
+  for (int vertex = 0; vertex < vertexCount; ++vertex) {
+    std::shuffle(letters.begin(), letters.end(), randomGenerator);
+    size_t edgeCount = 1 + randomGenerator() % 60;
+    for (size_t position = 0; position < edgeCount; ++position) {
+      randomAutomaton.insertEdge(vertex, static_cast<int>(randomGenerator() % vertexCount), static_cast<char>(letters[position]));
+    }
+  }
+  finiteAutomaton_table<int, char> table(randomAutomaton);
+  finiteAutomaton_compressedTable<int, char> compressed(randomAutomaton);
+  for (size_t vertex = 0; vertex < table.vertexCount(); ++vertex) {
+    for (int letter = -128; letter < 128; ++letter) {
+      ASSERT_EQ(compressed.step(vertex, static_cast<char>(letter)), table.step(vertex, static_cast<char>(letter)));
+    }
+  }
+  ASSERT_LT(compressed.memoryUsage(), table.transitions.size() * sizeof(int));
+}
+
 int main(int args, char *argv[]) {
   ::testing::InitGoogleTest(&args, argv);
   return RUN_ALL_TESTS();